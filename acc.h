@@ -25,6 +25,27 @@
 #define ACCL_ADDR           0x1D
 
 #define ACCL_INT            0x2E
+#define ACCL_INT_MAP        0x2F
+#define ACCL_INT_SOURCE     0x30
+// Parameters for ACCL_INT, ACCL_INT_MAP and ACCL_INT_SOURCE:
+#define ACCL_INT_DATA_READY 0x80
+#define ACCL_INT_ACTIVITY   0x10
+#define ACCL_INT_INACTIVITY 0x08
+#define ACCL_INT_FREE_FALL  0x04
+
+#define ACCL_THRESH_ACT     0x24
+#define ACCL_THRESH_INACT   0x25
+#define ACCL_TIME_INACT     0x26
+#define ACCL_ACT_INACT_CTL  0x27
+// Parameters for ACCL_ACT_INACT_CTL:
+#define ACCL_ACT_AC         0x80
+#define ACCL_ACT_XYZ        0x70
+#define ACCL_INACT_AC       0x08
+#define ACCL_INACT_XYZ      0x07
+
+#define ACCL_THRESH_FF      0x28
+#define ACCL_TIME_FF        0x29
+
 #define ACCL_OFFSET_X       0x1E
 #define ACCL_OFFSET_Y       0x1F
 #define ACCL_OFFSET_Z       0x20
@@ -33,6 +54,7 @@
 
 #define ACCL_PWR_CTL        0x2D
 // Parameters for ACCL_PWR_CTL:
+#define ACCL_LINK           0x20
 #define ACCL_MEASURE        0x08
 
 #define ACCL_DATA_FORMAT    0x31
@@ -41,6 +63,7 @@
 #define ACCL_RANGE_4G       0x01
 #define ACCL_RANGE_8G       0x02
 #define ACCL_RANGE_16G      0x03
+#define ACCL_INT_INVERT     0x20
 #define ACCL_FULL_RES       0x08
 #define ACCL_JUSTIFY        0x04
 
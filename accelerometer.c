@@ -13,7 +13,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
-#include <math.h>
 #include "inc/hw_memmap.h"
 #include "driverlib/pin_map.h"
 #include "driverlib/sysctl.h"
@@ -21,40 +20,223 @@
 #include "driverlib/i2c.h"
 #include "acc.h"
 #include "i2c_driver.h"
-#include "circBufT.h"
 
 #include "accelerometer.h"
+#include "units.h"
+#include "step_detector.h"
 
-#define BUF_SIZE 12
+/* Output data rates and their ACCL_BW_RATE register values, indexed by accl_rate. */
+static const uint16_t accl_rates_hz[ACCL_RATE_COUNT] = { 25, 50, 100 };
+static const uint8_t accl_bw_rates[ACCL_RATE_COUNT] = { ACCL_RATE_25HZ, ACCL_RATE_50HZ,
+		ACCL_RATE_100HZ };
 
-/* Circular buffer for each axis.
- * Each of size BUF_SIZE to store accelerometer data */
-static circBuf_t x_buffer;
-static circBuf_t y_buffer;
-static circBuf_t z_buffer;
+/* The rate the accelerometer is currently set to. */
+static accl_rate current_rate = ACCL_DEFAULT_RATE;
 
-/* Circular buffer that stores the average of the x,y,z accelerometer values */
-static circBuf_t mag_buffer;
+/* The step detector fed by the accelerometer. It runs at the selected rate and
+ * is not fed while idle. */
+static step_detector_t step_detector;
+
+/* The peaks of the steps confirmed by the last sample detected. */
+static uint32_t step_peaks[ACCL_STEP_PEAKS];
+static uint16_t step_peak_count;
+
+/* The range and rate selected with configure_accl. */
+static accl_range selected_range = ACCL_DEFAULT_RANGE;
+static accl_rate selected_rate = ACCL_DEFAULT_RATE;
+
+/* The accelerometer decides when the wearer is still with its own activity and
+ * inactivity detection, linked so each is only looked for after the other. On
+ * inactivity the rate drops to ACCL_IDLE_RATE and the accelerometer is no longer
+ * read, on activity it comes back. Both are AC coupled on every axis, measured
+ * from the reading when detection started. The thresholds are in 62.5mg steps. */
+
+/* Any axis moving more than 62.5mg is activity, ~4 times the noise on a still
+ * device and below the swing of the lightest walk. */
+#define ACTIVITY_THRESHOLD 1
+
+/* Every axis staying within 62.5mg for IDLE_DELAY_S seconds is inactivity. This
+ * is longer than a pause while walking, such as waiting to cross the road. */
+#define INACTIVITY_THRESHOLD 1
+#define IDLE_DELAY_S 10
+
+/* The magnitude below 375mg on every axis for 300ms is free fall, in 62.5mg and
+ * 5ms steps. This is longer than the flight of a running stride, so only drops
+ * are caught. */
+#define FREE_FALL_THRESHOLD 6
+#define FREE_FALL_TIME 60
+
+/* True while the rate is dropped to ACCL_IDLE_RATE. */
+static bool idle;
+
+/* Set by the interrupt when the accelerometer raises an event on INT1. */
+static volatile bool accl_event_pending;
+
+/* Readings averaged at start up to calibrate the offsets and seed the detector,
+ * 0.32 seconds at the default 50Hz output data rate. */
+#define CALIBRATION_SAMPLES 16
+
+/* The offset registers are in 15.6mg steps, 4 full resolution LSB each. */
+#define ACCL_OFFSET_LSB (ACCL_FULL_RES_LSB_PER_G / 64)
+
+/* Calibration only trusts readings that vary by less than this on every axis,
+ * ~0.05g, so the device was still. */
+#define CALIBRATION_MAX_SPREAD (ACCL_FULL_RES_LSB_PER_G * 3 / 64)
+
+/* Offsets are only programmed when the device lies within this of 1g along one
+ * axis and 0 along the others, 8 LSB or ~31mg, under 2 degrees of tilt. A larger
+ * error is more likely the way the device was lying at power on than offset in
+ * the sensor, and programming it would bias every later reading, so then the
+ * readings only seed the detector. */
+#define CALIBRATION_MAX_ERROR (ACCL_OFFSET_LSB * 2)
+
+/* Offsets programmed into the accelerometer, in ACCL_OFFSET_LSB steps. */
+static int8_t accl_offsets[3];
+
+static vector3_t calibrate_accl(void);
+
+/* Writes the range and output data rate to the accelerometer. */
+static void set_accl_config(accl_range range, accl_rate rate) {
+	char toAccl[] = { 0, 0 };  // parameter, value
+
+	// full resolution keeps 256 LSB per g at every range, active high interrupts
+	toAccl[0] = ACCL_DATA_FORMAT;
+	toAccl[1] = (range | ACCL_FULL_RES);
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	current_rate = rate;
+	toAccl[0] = ACCL_BW_RATE;
+	toAccl[1] = accl_bw_rates[rate];
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+}
+
+/* Selects the measurement range and output data rate together. */
+void configure_accl(accl_range range, accl_rate rate) {
+	selected_range = range;
+	selected_rate = rate;
+	idle = false;
+	set_accl_config(range, rate);
+	set_step_detector_rate(&step_detector, accl_rates_hz[rate]);
+}
+
+/* Records that the accelerometer raised an event, which is read from the main loop. */
+static void accl_int_handler(void) {
+	GPIOIntClear(ACCL_INT1Port, ACCL_INT1);
+	accl_event_pending = true;
+}
+
+/* Programs the activity, inactivity and free fall detection and routes their
+ * interrupts to INT1. INT2 shares its GPIO port with the UP button, whose
+ * interrupt wakes the monitor from deep sleep. */
+static void init_accl_events(void) {
+	char toAccl[] = { 0, 0 };  // parameter, value
+
+	toAccl[0] = ACCL_THRESH_ACT;
+	toAccl[1] = ACTIVITY_THRESHOLD;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_THRESH_INACT;
+	toAccl[1] = INACTIVITY_THRESHOLD;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_TIME_INACT;
+	toAccl[1] = IDLE_DELAY_S;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_ACT_INACT_CTL;
+	toAccl[1] = ACCL_ACT_AC | ACCL_ACT_XYZ | ACCL_INACT_AC | ACCL_INACT_XYZ;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_THRESH_FF;
+	toAccl[1] = FREE_FALL_THRESHOLD;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_TIME_FF;
+	toAccl[1] = FREE_FALL_TIME;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_INT_MAP;
+	toAccl[1] = 0;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	toAccl[0] = ACCL_INT;
+	toAccl[1] = ACCL_INT_ACTIVITY | ACCL_INT_INACTIVITY | ACCL_INT_FREE_FALL;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	// link activity and inactivity, starting with looking for inactivity
+	toAccl[0] = ACCL_PWR_CTL;
+	toAccl[1] = ACCL_LINK | ACCL_MEASURE;
+	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+
+	/* Reading the source clears any event already raised, so the line is low
+	 * and the next event gives a rising edge. */
+	toAccl[0] = ACCL_INT_SOURCE;
+	I2CGenTransmit(toAccl, 1, READ, ACCL_ADDR);
+	accl_event_pending = false;
+
+	GPIOIntRegister(ACCL_INT1Port, accl_int_handler);
+	GPIOIntTypeSet(ACCL_INT1Port, ACCL_INT1, GPIO_RISING_EDGE);
+	GPIOIntClear(ACCL_INT1Port, ACCL_INT1);
+	GPIOIntEnable(ACCL_INT1Port, ACCL_INT1);
+}
+
+/* Handles the events raised by the accelerometer since the last call. */
+void handle_accl_events(void) {
+	if (!accl_event_pending) {
+		return;
+	}
+	accl_event_pending = false;
+
+	char fromAccl[] = { 0, 0 }; // starting address, placeholder for data to be read.
+	fromAccl[0] = ACCL_INT_SOURCE;
+	I2CGenTransmit(fromAccl, 1, READ, ACCL_ADDR);
+	uint8_t source = fromAccl[1];
+
+	/* A drop tumbles the device and lands with a knock, neither of which is
+	 * walking, so the steps waiting for confirmation and the gate block are
+	 * dropped and the detector starts again. */
+	if (source & ACCL_INT_FREE_FALL) {
+		seed_step_detector(&step_detector, step_detector_gravity(&step_detector));
+	}
+	/* Inactivity is checked first, as linking means activity can only
+	 * follow it if both were raised. */
+	if ((source & ACCL_INT_INACTIVITY) && !idle) {
+		idle = true;
+		set_accl_config(selected_range, ACCL_IDLE_RATE);
+	}
+	/* The detector restarts at the selected rate. The gait gate closed long
+	 * before the wearer went still, so it loses nothing. */
+	if ((source & ACCL_INT_ACTIVITY) && idle) {
+		idle = false;
+		set_accl_config(selected_range, selected_rate);
+		seed_step_detector(&step_detector, step_detector_gravity(&step_detector));
+	}
+}
+
+/* Returns the output data rate in Hz. */
+uint16_t accl_rate_hz(accl_rate rate) {
+	return accl_rates_hz[rate];
+}
+
+/* Returns the current output data rate in Hz. */
+uint16_t get_accl_sample_rate(void) {
+	return accl_rates_hz[current_rate];
+}
+
+/* Returns true while the rate is dropped to ACCL_IDLE_RATE. */
+bool accl_idle(void) {
+	return idle;
+}
+
+/* Returns true if an event has been raised that handle_accl_events has not handled. */
+bool accl_event_waiting(void) {
+	return accl_event_pending;
+}
 
 /* Initializes accelerometer.
  * Acknowledgments: Based off C. P. Moore*/
 void initAccl(void) {
 
-	initCircBuf(&x_buffer, BUF_SIZE);
-	initCircBuf(&y_buffer, BUF_SIZE);
-	initCircBuf(&z_buffer, BUF_SIZE);
-	initCircBuf(&mag_buffer, BUF_SIZE);
-
-	/* This prevents a step being accounted as the magnitude buffer gets filled initially.
-	 * This assignment forces magnitude value stays below the threshold until values stabilize. */
-	uint8_t i;
-	for (i = 0; i < BUF_SIZE; i++) {
-		writeCircBuf(&mag_buffer, 768);
-		writeCircBuf(&x_buffer, 256);
-		writeCircBuf(&y_buffer, 256);
-		writeCircBuf(&z_buffer, 256);
-	}
-
 	char toAccl[] = { 0, 0 };  // parameter, value
 
 	/*
@@ -78,22 +260,18 @@ void initAccl(void) {
 	 */
 	I2CMasterInitExpClk(I2C0_BASE, SysCtlClockGet(), true);
 
-	GPIOPinTypeGPIOInput(ACCL_INT2Port, ACCL_INT2);
+	GPIOPinTypeGPIOInput(ACCL_INT1Port, ACCL_INT1);
 
 	//Initialize ADXL345 Accelerometer
 
-	// set +-2g, 13 bit resolution, active low interrupts
-	toAccl[0] = ACCL_DATA_FORMAT;
-	toAccl[1] = (ACCL_RANGE_16G | ACCL_FULL_RES);
-	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
-
 	toAccl[0] = ACCL_PWR_CTL;
 	toAccl[1] = ACCL_MEASURE;
 	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
 
-	toAccl[0] = ACCL_BW_RATE;
-	toAccl[1] = ACCL_RATE_100HZ;
-	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+	selected_range = ACCL_DEFAULT_RANGE;
+	selected_rate = ACCL_DEFAULT_RATE;
+	idle = false;
+	set_accl_config(selected_range, selected_rate);
 
 	toAccl[0] = ACCL_OFFSET_X;
 	toAccl[1] = 0x00;
@@ -106,6 +284,12 @@ void initAccl(void) {
 	toAccl[0] = ACCL_OFFSET_Z;
 	toAccl[1] = 0x00;
 	I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+	accl_offsets[0] = 0;
+	accl_offsets[1] = 0;
+	accl_offsets[2] = 0;
+
+	init_step_detector(&step_detector, accl_rates_hz[selected_rate], calibrate_accl());
+	init_accl_events();
 }
 
 /* Function to read raw accelerometer data into a vector with x, y, z. */
@@ -124,55 +308,101 @@ static vector3_t get_raw_accl_data(void) {
 	return acceleration;
 }
 
-/* Returns mean content in a circular buffer for the accelerometer.
- * Similar to adc_average_buffer but the difference is the int types returned. */
-static int16_t acc_average_buffer(circBuf_t buffer) {
-	int32_t sum = 0;
-	uint8_t i;
-	for (i = 0; i < BUF_SIZE; i++) {
-		sum = sum + readCircBuf(&buffer);
+/* Averages readings taken one output data period apart.
+ * Returns false if the device moved while they were taken. */
+static bool read_rest_average(vector3_t *average) {
+	int32_t sum[3] = { 0, 0, 0 };
+	int16_t min[3] = { INT16_MAX, INT16_MAX, INT16_MAX };
+	int16_t max[3] = { INT16_MIN, INT16_MIN, INT16_MIN };
+	uint8_t n;
+	uint8_t axis;
+	for (n = 0; n < CALIBRATION_SAMPLES; n++) {
+		/* SysCtlDelay takes 3 cycles per count, this waits one period for a new reading. */
+		SysCtlDelay(SysCtlClockGet() / 3 / accl_rates_hz[current_rate]);
+		vector3_t reading = get_raw_accl_data();
+		int16_t axes[3] = { reading.x, reading.y, reading.z };
+		for (axis = 0; axis < 3; axis++) {
+			sum[axis] += axes[axis];
+			min[axis] = axes[axis] < min[axis] ? axes[axis] : min[axis];
+			max[axis] = axes[axis] > max[axis] ? axes[axis] : max[axis];
+		}
 	}
-	/* This method of determining the average allows us to forego using floats.
-	 * To get around floats, the sum is doubled then halved later.
-	 * It guarantees that the average calculated will be >0.5 (BUFF_SIZE/(2*BUFF_SIZE)).
-	 * Then if sum is not 0, this method will round upwards if needed. */
-	return ((2 * sum + BUF_SIZE) / 2 / BUF_SIZE);
+	average->x = sum[0] / CALIBRATION_SAMPLES;
+	average->y = sum[1] / CALIBRATION_SAMPLES;
+	average->z = sum[2] / CALIBRATION_SAMPLES;
+	for (axis = 0; axis < 3; axis++) {
+		if (max[axis] - min[axis] > CALIBRATION_MAX_SPREAD) {
+			return false;
+		}
+	}
+	return true;
 }
 
-/* Function to read raw accelerometer data into a vector with x, y, z and then
- * convert it to the appropriate units based on unit_state. */
-vector3_t get_accl_data(void) {
-	vector3_t raw_vector = get_raw_accl_data();
-	writeCircBuf(&x_buffer, raw_vector.x);
-	writeCircBuf(&y_buffer, raw_vector.y);
-	writeCircBuf(&z_buffer, raw_vector.z);
-
-	vector3_t raw_vector_avg;
-	raw_vector_avg.x = acc_average_buffer(x_buffer);
-	raw_vector_avg.y = acc_average_buffer(y_buffer);
-	raw_vector_avg.z = acc_average_buffer(z_buffer);
-
-	return raw_vector_avg;
-}
-
-/* Detects whether a step was taken based on comparing the magnitude to the last magnitude.
- * Returns true if the threshold for a step has been surpassed. */
-bool detect_step(vector3_t acceleration) {
-	int16_t mag_acc = sqrt(
-			(acceleration.y * acceleration.y)
-					+ (acceleration.z * acceleration.z)
-					+ (acceleration.x * acceleration.x));
-
-	/* Gets rid of the effect of gravity from the magnitude. */
-	int16_t mag_acc_final = mag_acc - acc_average_buffer(mag_buffer);
-	writeCircBuf(&mag_buffer, mag_acc);
-	/* TODO: Make the threshold dynamic.
-	 * The threshold 21 has been calculated based on the lower bound average walking speed (0.8m per second).
-	 * The accelerometer can detect up to 1g on each axis and the raw units are in a range of [0, ~256].
-	 * 0.8 / 9.807 = ~0.081
-	 * 0.081 * 256 = ~21 */
-	if (mag_acc_final > 21) {
-		return true;
+/* Burst reads the accelerometer. If the device is lying still and level on a face,
+ * the offset registers are adjusted so it reads exactly 1g along that axis and 0
+ * along the others. Returns the average reading, with the offsets applied. */
+static vector3_t calibrate_accl(void) {
+	vector3_t rest;
+	if (!read_rest_average(&rest)) {
+		return rest;
+	}
+	int16_t axes[3] = { rest.x, rest.y, rest.z };
+	int16_t expected[3] = { 0, 0, 0 };
+	uint8_t down = 0;
+	uint8_t axis;
+	for (axis = 1; axis < 3; axis++) {
+		if (abs(axes[axis]) > abs(axes[down])) {
+			down = axis;
+		}
+	}
+	expected[down] = axes[down] < 0 ? -ACCL_FULL_RES_LSB_PER_G : ACCL_FULL_RES_LSB_PER_G;
+	for (axis = 0; axis < 3; axis++) {
+		if (abs(expected[axis] - axes[axis]) > CALIBRATION_MAX_ERROR) {
+			return rest;
+		}
+	}
+
+	char toAccl[] = { 0, 0 };  // parameter, value
+	for (axis = 0; axis < 3; axis++) {
+		int16_t error = expected[axis] - axes[axis];
+		int8_t adjust = (error + (error < 0 ? -ACCL_OFFSET_LSB / 2 : ACCL_OFFSET_LSB / 2))
+				/ ACCL_OFFSET_LSB;
+		accl_offsets[axis] += adjust;
+		toAccl[0] = ACCL_OFFSET_X + axis;
+		toAccl[1] = accl_offsets[axis];
+		I2CGenTransmit(toAccl, 1, WRITE, ACCL_ADDR);
+		axes[axis] += adjust * ACCL_OFFSET_LSB;
 	}
-	return false;
+	rest.x = axes[0];
+	rest.y = axes[1];
+	rest.z = axes[2];
+	return rest;
+}
+
+/* Reads the latest raw accelerometer data, in full resolution LSB, into a
+ * vector with x, y, z. Conversion for display is done by units. */
+vector3_t get_accl_data(void) {
+	return get_raw_accl_data();
+}
+
+/* Detects steps in one sample. Returns the number of steps confirmed. */
+uint16_t detect_step(vector3_t acceleration) {
+	int16_t x = acceleration.x;
+	int16_t y = acceleration.y;
+	int16_t z = acceleration.z;
+	uint16_t steps = push_step_block(&step_detector, &x, &y, &z, 1, step_peaks,
+			ACCL_STEP_PEAKS);
+	step_peak_count = steps < ACCL_STEP_PEAKS ? steps : ACCL_STEP_PEAKS;
+	return steps;
+}
+
+/* Points peaks at the peaks of the steps the last detect_step confirmed. */
+uint16_t get_step_peaks(const uint32_t **peaks) {
+	*peaks = step_peaks;
+	return step_peak_count;
+}
+
+/* Returns the cadence in steps per minute, 0 if not walking or running. */
+uint16_t get_cadence(void) {
+	return step_detector_cadence(&step_detector);
 }
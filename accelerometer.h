@@ -13,23 +13,85 @@
 #ifndef ACCELEROMETER_H
 #define ACCELEROMETER_H
 
+/* Measurement ranges, in the order of the ADXL345 range bits. Readings are full
+ * resolution, 256 LSB per g, at every range, so a wider range only adds headroom
+ * before hard running or impacts clip. */
+typedef enum {
+	ACCL_2G, ACCL_4G, ACCL_8G, ACCL_16G
+} accl_range;
+
+/* Output data rates the step detector has coefficients for. The accelerometer is
+ * sampled at the output data rate. Lower rates draw less current, the ADXL345 takes
+ * ~140uA at 100Hz, ~90uA at 50Hz and ~60uA at 25Hz. 25Hz is the lowest, it is the
+ * rate the cadence is measured at. */
+typedef enum {
+	ACCL_25HZ, ACCL_50HZ, ACCL_100HZ, ACCL_RATE_COUNT
+} accl_rate;
+
+/* Configuration set up by initAccl. */
+#define ACCL_DEFAULT_RANGE ACCL_16G
+#define ACCL_DEFAULT_RATE ACCL_50HZ
+
+/* Rate the accelerometer drops to while the wearer is still. Only its own
+ * activity detection runs at this rate, the accelerometer is not read. */
+#define ACCL_IDLE_RATE ACCL_25HZ
+
 typedef struct {
 	int16_t x;
 	int16_t y;
 	int16_t z;
 } vector3_t;
 
-typedef enum {
-	DISPLAY_RAW, DISPLAY_G, DISPLAY_MS2
-} display_unit;
-
-/* Initializes accelerometer. */
+/* Initializes accelerometer. Takes 16 readings at rest, 0.32 seconds at the
+ * default 50Hz, to calibrate against and seed the step detector from. */
 void initAccl(void);
 
-/* Function to read raw accelerometer data into a vector with x, y, z and then
- * convert it to the appropriate units based on unit_state. */
+/* Reads the latest raw accelerometer data, in full resolution LSB, into a
+ * vector with x, y, z. Conversion for display is done by units. */
 vector3_t get_accl_data(void);
 
-bool detect_step(vector3_t acceleration);
+/* Selects the measurement range and output data rate together. The step detector
+ * switches to the filters, gate blocks and durations for the new rate and carries
+ * on from the current estimate of gravity. The rate drops to ACCL_IDLE_RATE while
+ * the accelerometer reports inactivity and comes back to the selected rate when
+ * it reports activity. */
+void configure_accl(accl_range range, accl_rate rate);
+
+/* Returns the output data rate in Hz. */
+uint16_t accl_rate_hz(accl_rate rate);
+
+/* Returns the current output data rate in Hz, the rate at which
+ * handle_step_event must be called while not idle. This changes as the rate
+ * drops to idle and comes back, so must be checked before every sample. */
+uint16_t get_accl_sample_rate(void);
+
+/* Returns true while the accelerometer reports the wearer is still. The
+ * accelerometer must not be read while idle. */
+bool accl_idle(void);
+
+/* Returns true if the accelerometer has raised an event that has not been handled.
+ * Used to check there is nothing to do before the CPU goes to sleep. */
+bool accl_event_waiting(void);
+
+/* Handles activity, inactivity and free fall raised by the accelerometer on its
+ * interrupt. Must be called from the main loop, as it reads the accelerometer. */
+void handle_accl_events(void);
+
+/* Feeds one sample to the step detector the accelerometer keeps, which follows
+ * the rate and restarts on the accelerometer's events. See push_step_samples.
+ * Returns the number of steps confirmed by this sample, which can include steps
+ * that waited for confirmation. Must be called once per sample. */
+uint16_t detect_step(vector3_t acceleration);
+
+/* Most step peaks kept from one call of detect_step. */
+#define ACCL_STEP_PEAKS 32
+
+/* Points peaks at the sample of the peak of each step the last detect_step
+ * confirmed, numbered from 0 for the first sample detected after initAccl, and
+ * returns how many there are, up to ACCL_STEP_PEAKS. For tools that time steps. */
+uint16_t get_step_peaks(const uint32_t **peaks);
+
+/* Returns the cadence in steps per minute, 0 if not walking or running. */
+uint16_t get_cadence(void);
 
 #endif /* ACCELEROMETER_H */
@@ -0,0 +1,40 @@
+/*
+ * File: biquad.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Second order IIR filter sections in fixed point, in direct form 1 with a
+ * 64 bit accumulator (a single multiply accumulate per tap on the Cortex-M4).
+ */
+
+#include <stdint.h>
+
+#include "biquad.h"
+
+/* Initializes a filter as if it had settled with a constant input and output. */
+void init_biquad(biquad_t *filter, const biquad_coefs_t *coefs, int32_t input,
+		int32_t output) {
+	filter->coefs = coefs;
+	filter->x1 = input;
+	filter->x2 = input;
+	filter->y1 = output;
+	filter->y2 = output;
+}
+
+/* Filters one sample, returning the output. */
+int32_t update_biquad(biquad_t *filter, int32_t input) {
+	const biquad_coefs_t *c = filter->coefs;
+	int64_t acc = (int64_t) c->b0 * input;
+	acc += (int64_t) c->b1 * filter->x1;
+	acc += (int64_t) c->b2 * filter->x2;
+	acc -= (int64_t) c->a1 * filter->y1;
+	acc -= (int64_t) c->a2 * filter->y2;
+	int32_t output = (int32_t) ((acc + (1 << (BIQUAD_COEF_BITS - 1))) >> BIQUAD_COEF_BITS);
+	filter->x2 = filter->x1;
+	filter->x1 = input;
+	filter->y2 = filter->y1;
+	filter->y1 = output;
+	return output;
+}
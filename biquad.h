@@ -0,0 +1,73 @@
+/*
+ * File: biquad.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Second order IIR filter sections in fixed point. Coefficients are Q30 and are
+ * generated by the compiler from the cut off and sample rate with the macros
+ * below, so changing the sample rate only needs a rebuild.
+ */
+
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include "const_trig.h"
+
+/* Fractional bits of the coefficients. Q30 holds the +-2 range of a1. */
+#define BIQUAD_COEF_BITS 30
+
+/* Quality factor of a Butterworth section. */
+#define BIQUAD_BUTTERWORTH_Q 0.70710678118654752
+
+typedef struct {
+	int32_t b0;
+	int32_t b1;
+	int32_t b2;
+	int32_t a1;
+	int32_t a2;
+} biquad_coefs_t;
+
+typedef struct {
+	const biquad_coefs_t *coefs;
+	int32_t x1; /* Previous two inputs and outputs. */
+	int32_t x2;
+	int32_t y1;
+	int32_t y2;
+} biquad_t;
+
+/* Intermediate values of the Audio EQ Cookbook designs, as constant expressions. */
+#define BIQUAD_W0(f0, fs) (2 * CONST_PI * (f0) / (fs))
+#define BIQUAD_ALPHA(f0, fs) (CONST_SIN(BIQUAD_W0(f0, fs)) / (2 * BIQUAD_BUTTERWORTH_Q))
+#define BIQUAD_COS(f0, fs) CONST_COS(BIQUAD_W0(f0, fs))
+#define BIQUAD_Q30(value, f0, fs) \
+	((int32_t) ((value) / (1 + BIQUAD_ALPHA(f0, fs)) * (1 << BIQUAD_COEF_BITS) \
+			+ ((value) >= 0 ? 0.5 : -0.5)))
+
+/* Butterworth low pass coefficients for cut off f0 at sample rate fs, both in Hz. */
+#define BIQUAD_LOWPASS(f0, fs) { \
+	BIQUAD_Q30((1 - BIQUAD_COS(f0, fs)) / 2, f0, fs), \
+	BIQUAD_Q30(1 - BIQUAD_COS(f0, fs), f0, fs), \
+	BIQUAD_Q30((1 - BIQUAD_COS(f0, fs)) / 2, f0, fs), \
+	BIQUAD_Q30(-2 * BIQUAD_COS(f0, fs), f0, fs), \
+	BIQUAD_Q30(1 - BIQUAD_ALPHA(f0, fs), f0, fs) }
+
+/* Butterworth high pass coefficients for cut off f0 at sample rate fs, both in Hz. */
+#define BIQUAD_HIGHPASS(f0, fs) { \
+	BIQUAD_Q30((1 + BIQUAD_COS(f0, fs)) / 2, f0, fs), \
+	BIQUAD_Q30(-(1 + BIQUAD_COS(f0, fs)), f0, fs), \
+	BIQUAD_Q30((1 + BIQUAD_COS(f0, fs)) / 2, f0, fs), \
+	BIQUAD_Q30(-2 * BIQUAD_COS(f0, fs), f0, fs), \
+	BIQUAD_Q30(1 - BIQUAD_ALPHA(f0, fs), f0, fs) }
+
+/* Initializes a filter as if it had settled with a constant input giving a constant
+ * output, so it starts without a transient. For a high pass section the settled
+ * output is 0, for a low pass section it is the input. */
+void init_biquad(biquad_t *filter, const biquad_coefs_t *coefs, int32_t input,
+		int32_t output);
+
+/* Filters one sample, returning the output. Inputs should stay within +-2^24. */
+int32_t update_biquad(biquad_t *filter, int32_t input);
+
+#endif /* BIQUAD_H */
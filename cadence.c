@@ -0,0 +1,209 @@
+/*
+ * File: cadence.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Cadence estimation and step confirmation from the average magnitude
+ * difference function of the decimated filtered magnitude.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cadence.h"
+#include "dsp.h"
+
+/* The window is periodic when the AMDF at the step period is below 1 / 2^CADENCE_PERIODIC_SHIFT
+ * of the largest AMDF, i.e. the signal repeats much more closely than it differs at worst. */
+#define CADENCE_PERIODIC_SHIFT 1
+
+/* Of the lags within 1 / 2^CADENCE_DIP_SHIFT of the AMDF range above its minimum, the
+ * shortest is taken. Multiples of the step period dip as deep, and the stride, two steps,
+ * can dip deeper when one leg lands harder than the other. */
+#define CADENCE_DIP_SHIFT 2
+
+/* Initializes the estimator for input samples at decimation * CADENCE_RATE_HZ. */
+void init_cadence(cadence_t *cadence, uint8_t decimation) {
+	uint16_t i;
+	for (i = 0; i < 2 * CADENCE_HISTORY; i++) {
+		cadence->history[i] = 0;
+	}
+	for (i = 0; i < CADENCE_LAGS; i++) {
+		cadence->amdf[i] = 0;
+	}
+	for (i = 0; i < CADENCE_PENDING_BLOCKS; i++) {
+		cadence->pending[i] = 0;
+	}
+	cadence->head = 0;
+	cadence->decimation_sum = 0;
+	cadence->decimation = decimation;
+	cadence->decimation_count = 0;
+	cadence->block_count = 0;
+	cadence->period = 0;
+	cadence->confirmed = 0;
+	cadence->peak_count = 0;
+}
+
+/* Removes count peaks from first on, oldest first. */
+static void remove_peaks(cadence_t *cadence, uint8_t first, uint16_t count) {
+	if (first >= cadence->peak_count) {
+		return;
+	}
+	if (count > cadence->peak_count - first) {
+		count = cadence->peak_count - first;
+	}
+	uint8_t i;
+	for (i = first; i + count < cadence->peak_count; i++) {
+		cadence->peaks[i] = cadence->peaks[i + count];
+	}
+	cadence->peak_count -= count;
+}
+
+/* Returns the history sample the given number of decimated samples before the head,
+ * from the second copy so earlier samples follow it without wrapping. */
+static const int16_t *history_before(const cadence_t *cadence, uint16_t age) {
+	return &cadence->history[cadence->head + CADENCE_HISTORY - age];
+}
+
+/* Slides the AMDF window along by one decimated sample. Each lag gains the
+ * difference for the new sample and loses the one for the sample leaving the window. */
+static void push_sample(cadence_t *cadence, int16_t sample) {
+	int16_t leaving = *history_before(cadence, CADENCE_WINDOW);
+	dsp_slide_amdf(cadence->amdf, CADENCE_LAGS, sample,
+			history_before(cadence, CADENCE_MIN_LAG), leaving,
+			history_before(cadence, CADENCE_WINDOW + CADENCE_MIN_LAG));
+	/* The sample overwritten is the oldest, only needed above at the longest lag. */
+	cadence->history[cadence->head] = sample;
+	cadence->history[cadence->head + CADENCE_HISTORY] = sample;
+	cadence->head = cadence->head + 1 < CADENCE_HISTORY ? cadence->head + 1 : 0;
+}
+
+/* Searches the AMDF for the step period, 0 if the window is not periodic. */
+static uint16_t find_period(const cadence_t *cadence) {
+	const uint32_t *amdf = cadence->amdf;
+	uint32_t min = UINT32_MAX;
+	uint32_t max = 0;
+	uint16_t i;
+	for (i = 0; i < CADENCE_LAGS; i++) {
+		if (amdf[i] < min) {
+			min = amdf[i];
+		}
+		if (amdf[i] > max) {
+			max = amdf[i];
+		}
+	}
+	uint32_t dip = min + ((max - min) >> CADENCE_DIP_SHIFT);
+	/* The period must be a local minimum, so the lags at the ends are not candidates. */
+	for (i = 1; i < CADENCE_LAGS - 1; i++) {
+		if (amdf[i] <= dip && amdf[i] <= amdf[i - 1] && amdf[i] <= amdf[i + 1]) {
+			break;
+		}
+	}
+	if (i == CADENCE_LAGS - 1 || (amdf[i] << CADENCE_PERIODIC_SHIFT) >= max) {
+		return 0;
+	}
+	/* Fit a parabola through the minimum and its neighbours for a fraction of a lag,
+	 * which is ~7% of the cadence at a brisk walk. */
+	int32_t before = amdf[i - 1];
+	int32_t after = amdf[i + 1];
+	int32_t curvature = before - 2 * (int32_t) amdf[i] + after;
+	int32_t offset = 0;
+	if (curvature > 0) {
+		offset = (before - after) * (1 << (CADENCE_PERIOD_FRAC_BITS - 1)) / curvature;
+	}
+	return ((i + CADENCE_MIN_LAG) << CADENCE_PERIOD_FRAC_BITS) + offset;
+}
+
+/* Searches for the period at the end of a block, confirming the pending steps
+ * if the window is periodic and otherwise dropping those that have been in
+ * the window for its whole length. */
+static void end_block(cadence_t *cadence) {
+	cadence->period = find_period(cadence);
+	uint8_t i;
+	if (cadence->period != 0) {
+		for (i = 0; i < CADENCE_PENDING_BLOCKS; i++) {
+			cadence->confirmed += cadence->pending[i];
+			cadence->pending[i] = 0;
+		}
+	} else {
+		/* The oldest pending steps follow the confirmed ones. */
+		remove_peaks(cadence, cadence->confirmed, cadence->pending[CADENCE_PENDING_BLOCKS - 1]);
+		for (i = CADENCE_PENDING_BLOCKS - 1; i > 0; i--) {
+			cadence->pending[i] = cadence->pending[i - 1];
+		}
+		cadence->pending[0] = 0;
+	}
+}
+
+/* Feeds one filtered magnitude sample and whether a step was detected on it. */
+void update_cadence(cadence_t *cadence, int32_t value, bool step, uint32_t peak) {
+	if (step) {
+		add_cadence_step(cadence, peak);
+	}
+
+	cadence->decimation_sum += value;
+	cadence->decimation_count++;
+	if (cadence->decimation_count < cadence->decimation) {
+		return;
+	}
+	push_cadence_sum(cadence, cadence->decimation_sum);
+	cadence->decimation_sum = 0;
+	cadence->decimation_count = 0;
+}
+
+/* Counts a step detected on the latest input sample. */
+void add_cadence_step(cadence_t *cadence, uint32_t peak) {
+	if (cadence->peak_count < CADENCE_MAX_PEAKS) {
+		cadence->peaks[cadence->peak_count++] = peak;
+	}
+	/* Steps while the motion is already periodic are counted straight away. */
+	if (cadence->period != 0) {
+		cadence->confirmed++;
+	} else {
+		cadence->pending[0]++;
+	}
+}
+
+/* Feeds the sum of the input samples of one decimated sample. */
+void push_cadence_sum(cadence_t *cadence, int32_t sum) {
+	int32_t sample = sum / cadence->decimation;
+	if (sample > INT16_MAX) {
+		sample = INT16_MAX;
+	} else if (sample < INT16_MIN) {
+		sample = INT16_MIN;
+	}
+	push_sample(cadence, sample);
+
+	cadence->block_count++;
+	if (cadence->block_count == CADENCE_BLOCK) {
+		cadence->block_count = 0;
+		end_block(cadence);
+	}
+}
+
+/* Returns the steps confirmed since the last call, with their peaks. */
+uint16_t cadence_take_steps(cadence_t *cadence, uint32_t *peaks, uint16_t max_peaks) {
+	uint16_t steps = cadence->confirmed;
+	uint16_t i;
+	for (i = 0; i < steps && i < max_peaks && i < cadence->peak_count; i++) {
+		peaks[i] = cadence->peaks[i];
+	}
+	remove_peaks(cadence, 0, steps);
+	cadence->confirmed = 0;
+	return steps;
+}
+
+/* Returns the step period in decimated samples, 0 if the motion is not periodic. */
+uint16_t cadence_period(const cadence_t *cadence) {
+	return cadence->period;
+}
+
+/* Returns the cadence in steps per minute, 0 if the motion is not periodic. */
+uint16_t cadence_steps_per_minute(const cadence_t *cadence) {
+	if (cadence->period == 0) {
+		return 0;
+	}
+	return ((uint32_t) 60 * CADENCE_RATE_HZ << CADENCE_PERIOD_FRAC_BITS) / cadence->period;
+}
@@ -0,0 +1,98 @@
+/*
+ * File: cadence.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Cadence estimation from the periodicity of the filtered magnitude.
+ * The magnitude is decimated to CADENCE_RATE_HZ and the average magnitude
+ * difference function (AMDF) of the last CADENCE_WINDOW samples is kept for
+ * every lag a step could take. The sums are slid along one decimated sample at
+ * a time and searched for the step period once per block, so the cost is a
+ * fixed budget per second however fast the accelerometer is sampled.
+ *
+ * The estimator also confirms steps. Detected steps wait as pending until the
+ * window they fall in is found to be periodic, and are dropped if it never is,
+ * so isolated knocks and bumps are not counted.
+ */
+
+#ifndef CADENCE_H
+#define CADENCE_H
+
+/* Rate the magnitude is decimated to before the AMDF. */
+#define CADENCE_RATE_HZ 25
+
+/* Decimated samples the AMDF is taken over, 4 seconds. */
+#define CADENCE_WINDOW (CADENCE_RATE_HZ * 4)
+
+/* Decimated samples between period searches, 1 second. */
+#define CADENCE_BLOCK CADENCE_RATE_HZ
+
+/* Blocks a pending step waits for periodicity before it is dropped, the length of the window. */
+#define CADENCE_PENDING_BLOCKS (CADENCE_WINDOW / CADENCE_BLOCK)
+
+/* Step periods searched, 6 to 40 decimated samples or 37 to 250 steps per minute. */
+#define CADENCE_MIN_LAG 6
+#define CADENCE_MAX_LAG 40
+#define CADENCE_LAGS (CADENCE_MAX_LAG - CADENCE_MIN_LAG + 1)
+
+/* Decimated samples kept, enough to difference the whole window at the longest lag. */
+#define CADENCE_HISTORY (CADENCE_WINDOW + CADENCE_MAX_LAG)
+
+/* Fractional bits of the estimated period. */
+#define CADENCE_PERIOD_FRAC_BITS 4
+
+/* Peaks kept for the steps pending or confirmed and not yet taken. Steps are at
+ * least a quarter of a second apart, so at most ~4 arrive per block, and the
+ * pending steps of CADENCE_PENDING_BLOCKS blocks fit with room to spare. */
+#define CADENCE_MAX_PEAKS 32
+
+typedef struct {
+	int16_t history[2 * CADENCE_HISTORY];  /* Decimated magnitude, oldest overwritten first.
+	                                        * Written twice, CADENCE_HISTORY apart, so the
+	                                        * samples at every lag are contiguous. */
+	uint32_t amdf[CADENCE_LAGS];       /* Sum of |x[n] - x[n - lag]| over the window for each lag. */
+	uint16_t head;                     /* Index of the next history sample to write. */
+	int32_t decimation_sum;            /* Sum of the input samples in the current decimated sample. */
+	uint8_t decimation;                /* Input samples per decimated sample. */
+	uint8_t decimation_count;          /* Input samples in decimation_sum. */
+	uint8_t block_count;               /* Decimated samples since the last period search. */
+	uint16_t period;                   /* Step period in decimated samples with CADENCE_PERIOD_FRAC_BITS, 0 if not periodic. */
+	uint8_t pending[CADENCE_PENDING_BLOCKS];  /* Unconfirmed steps detected in each of the last blocks, newest first. */
+	uint16_t confirmed;                /* Confirmed steps not yet taken by the counter. */
+	uint32_t peaks[CADENCE_MAX_PEAKS]; /* Sample of the peak of each step not yet taken or
+	                                    * dropped, oldest first. The confirmed steps come
+	                                    * before the pending ones. */
+	uint8_t peak_count;                /* Peaks held, fewer than the steps only if full. */
+} cadence_t;
+
+/* Initializes the estimator for input samples at decimation * CADENCE_RATE_HZ.
+ * The history starts at zero, as the filtered magnitude is while still. */
+void init_cadence(cadence_t *cadence, uint8_t decimation);
+
+/* Feeds one filtered magnitude sample and whether a step was detected on it,
+ * with the caller's number for the sample of the step's peak. */
+void update_cadence(cadence_t *cadence, int32_t value, bool step, uint32_t peak);
+
+/* The two halves of update_cadence, for callers that sum the input samples of
+ * each decimated sample themselves, leaving decimation_sum and decimation_count
+ * unused. add_cadence_step counts a step detected on the latest input sample,
+ * and push_cadence_sum feeds the sum of the decimation input samples of one
+ * decimated sample, after any step on the last of them. */
+void add_cadence_step(cadence_t *cadence, uint32_t peak);
+void push_cadence_sum(cadence_t *cadence, int32_t sum);
+
+/* Returns the steps confirmed since the last call, writing the peak given for
+ * each, oldest first, to peaks, up to max_peaks of them, so peaks can be 0 if
+ * max_peaks is 0. */
+uint16_t cadence_take_steps(cadence_t *cadence, uint32_t *peaks, uint16_t max_peaks);
+
+/* Returns the step period in decimated samples with CADENCE_PERIOD_FRAC_BITS,
+ * 0 if the motion is not periodic. */
+uint16_t cadence_period(const cadence_t *cadence);
+
+/* Returns the cadence in steps per minute, 0 if the motion is not periodic. */
+uint16_t cadence_steps_per_minute(const cadence_t *cadence);
+
+#endif /* CADENCE_H */
@@ -0,0 +1,27 @@
+/*
+ * File: const_trig.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Sine and cosine written as constant expressions so filter coefficients can be
+ * computed by the compiler from the sample rate, with no floating point code or
+ * math library on the target. Accurate to better than 1e-6 for angles up to pi.
+ */
+
+#ifndef CONST_TRIG_H
+#define CONST_TRIG_H
+
+#define CONST_PI 3.14159265358979323846
+
+/* Taylor series in Horner form up to x^15 and x^16. */
+#define CONST_SIN(x) ((x) * (1 - (x) * (x) / 6 * (1 - (x) * (x) / 20 * (1 - (x) * (x) / 42 \
+		* (1 - (x) * (x) / 72 * (1 - (x) * (x) / 110 * (1 - (x) * (x) / 156 \
+		* (1 - (x) * (x) / 210 * (1 - (x) * (x) / 272)))))))))
+
+#define CONST_COS(x) (1 - (x) * (x) / 2 * (1 - (x) * (x) / 12 * (1 - (x) * (x) / 30 \
+		* (1 - (x) * (x) / 56 * (1 - (x) * (x) / 90 * (1 - (x) * (x) / 132 \
+		* (1 - (x) * (x) / 182 * (1 - (x) * (x) / 240))))))))
+
+#endif /* CONST_TRIG_H */
@@ -15,51 +15,188 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include "OrbitOLED/OrbitOLEDInterface.h"
-#include "utils/ustdlib.h"
 
 #include "display.h"
+#include "format.h"
+#include "units.h"
+
+#define DISPLAY_ROWS 4
+#define DISPLAY_COLS 16
+
+/* Text that has been posted to the display and text that has actually been drawn.
+ * Posting only updates the pending buffer; display_flush sends the differences
+ * to the OLED a few characters at a time so the SPI transfers never block the
+ * main loop for a whole string. */
+static char pending[DISPLAY_ROWS][DISPLAY_COLS];
+static char shown[DISPLAY_ROWS][DISPLAY_COLS];
+
+/* A bit per row that may differ between the pending and shown buffers. */
+static uint8_t dirty_rows;
+
+/* True while the OLED is blanked, text is still posted but not drawn. */
+static bool blanked;
 
 /* Initializes the Orbit OLED display */
 void initDisplay(void) {
 	OLEDInitialise();
+	uint8_t row;
+	uint8_t col;
+	for (row = 0; row < DISPLAY_ROWS; row++) {
+		for (col = 0; col < DISPLAY_COLS; col++) {
+			pending[row][col] = ' ';
+			shown[row][col] = ' ';
+		}
+	}
+	dirty_rows = 0;
+	blanked = false;
+}
+
+/* Posts text to be drawn starting at the given column and row.
+ * Text running past the edge of the display is dropped. */
+void display_string(char *text, uint8_t col, uint8_t row) {
+	if (row >= DISPLAY_ROWS) {
+		return;
+	}
+	while (*text != '\0' && col < DISPLAY_COLS) {
+		pending[row][col] = *text;
+		text++;
+		col++;
+	}
+	dirty_rows |= 1 << row;
+}
+
+/* Posts a whole row, padding the rest of the row with spaces. */
+static void display_row(char *text, uint8_t row) {
+	char line[DISPLAY_COLS + 1];
+	uint8_t col = 0;
+	while (*text != '\0' && col < DISPLAY_COLS) {
+		line[col++] = *text++;
+	}
+	while (col < DISPLAY_COLS) {
+		line[col++] = ' ';
+	}
+	line[DISPLAY_COLS] = '\0';
+	display_string(line, 0, row);
+}
+
+/* Draws up to max_chars characters that differ from what is on the OLED.
+ * Consecutive changed characters on a row are sent in a single draw call. */
+void display_flush(uint8_t max_chars) {
+	char run[DISPLAY_COLS + 1];
+	uint8_t row = 0;
+	if (blanked) {
+		return;
+	}
+	while (dirty_rows != 0 && max_chars > 0) {
+		while ((dirty_rows & (1 << row)) == 0) {
+			row++;
+		}
+		uint8_t col = 0;
+		while (col < DISPLAY_COLS && pending[row][col] == shown[row][col]) {
+			col++;
+		}
+		if (col == DISPLAY_COLS) {
+			dirty_rows &= ~(1 << row);
+			continue;
+		}
+		uint8_t start = col;
+		uint8_t len = 0;
+		while (col < DISPLAY_COLS && len < max_chars
+				&& pending[row][col] != shown[row][col]) {
+			run[len] = pending[row][col];
+			shown[row][col] = pending[row][col];
+			len++;
+			col++;
+		}
+		run[len] = '\0';
+		OLEDStringDraw(run, start, row);
+		max_chars -= len;
+	}
+}
+
+/* Returns true while posted text is still waiting to be drawn. */
+bool display_busy(void) {
+	return dirty_rows != 0 && !blanked;
+}
+
+/* Blanks the OLED at once, leaving the posted text to be drawn again by
+ * display_unblank. Lit pixels are most of the current the OLED draws. */
+void display_blank(void) {
+	uint8_t row;
+	uint8_t col;
+	for (row = 0; row < DISPLAY_ROWS; row++) {
+		for (col = 0; col < DISPLAY_COLS; col++) {
+			shown[row][col] = ' ';
+		}
+		OLEDStringDraw("                ", 0, row);
+	}
+	dirty_rows = (1 << DISPLAY_ROWS) - 1;
+	blanked = true;
+}
+
+/* Lets display_flush draw the posted text again after display_blank. */
+void display_unblank(void) {
+	blanked = false;
 }
 
 /* Update the display on the Orbit OLED display in form of "prefix: value". */
 void display_val(char *prefix, uint32_t value, uint8_t row) {
-	char text_buffer[17]; /* Display fits 16 characters wide. */
-	/* "Undraw" the previous contents of the line to be updated. */
-	OLEDStringDraw("                ", 0, row);
-	usnprintf(text_buffer, sizeof(text_buffer), "%s: %d", prefix, value);
-	/* Update line on display. */
-	OLEDStringDraw(text_buffer, 0, row);
+	char text_buffer[32]; /* Display fits 16 characters wide, display_row truncates the rest. */
+	uint8_t len = format_text(text_buffer, prefix);
+	len += format_text(text_buffer + len, ": ");
+	format_uint(text_buffer + len, value, 0, ' ');
+	/* Update line on display, padding over the previous contents of the line. */
+	display_row(text_buffer, row);
 }
 
 /* Update the display on the Orbit OLED display to show step related data. */
 void display_steps(uint32_t value, uint8_t row, char *units) {
-	char text_buffer[17]; /* Display fits 16 characters wide. */
-	/* "Undraw" the previous contents of the line to be updated. */
-	OLEDStringDraw("                ", 0, row);
-	usnprintf(text_buffer, sizeof(text_buffer), "%d %s", value, units);
-	/* Update line on display. */
-	OLEDStringDraw(text_buffer, 0, row);
+	char text_buffer[32]; /* Display fits 16 characters wide, display_row truncates the rest. */
+	uint8_t len = format_uint(text_buffer, value, 0, ' ');
+	text_buffer[len++] = ' ';
+	format_text(text_buffer + len, units);
+	/* Update line on display, padding over the previous contents of the line. */
+	display_row(text_buffer, row);
 }
 
 /* Update the display on the Orbit OLED display in form of "prefix: value units". */
 void display_val_units(char *prefix, uint32_t value, uint8_t row, char *units) {
-	char text_buffer[17]; /* Display fits 16 characters wide. */
-	/* "Undraw" the previous contents of the line to be updated. */
-	OLEDStringDraw("                ", 0, row);
-	usnprintf(text_buffer, sizeof(text_buffer), "%s%d.%03d %s", prefix,
-			value / 1000, abs(value % 1000), units);
-	/* Update line on display. */
-	OLEDStringDraw(text_buffer, 0, row);
+	char text_buffer[32]; /* Display fits 16 characters wide, display_row truncates the rest. */
+	uint8_t len = format_text(text_buffer, prefix);
+	len += format_fixed(text_buffer + len, value, 3);
+	text_buffer[len++] = ' ';
+	format_text(text_buffer + len, units);
+	/* Update line on display, padding over the previous contents of the line. */
+	display_row(text_buffer, row);
+}
+
+/* Text shown after an acceleration in each display unit. */
+static char *const accl_unit_text[DISPLAY_UNIT_COUNT] = { "raw", "g", "m/s2" };
+
+/* Update the display on the Orbit OLED display in form of "prefix: value units",
+ * with a raw accelerometer reading converted to the given unit. g and m/s^2 are
+ * shown to three decimal places. */
+void display_accl(char *prefix, int16_t raw, display_unit unit, uint8_t row) {
+	char text_buffer[32]; /* Display fits 16 characters wide, display_row truncates the rest. */
+	int32_t value = convert_accl_units(raw, unit);
+	uint8_t len = format_text(text_buffer, prefix);
+	len += format_text(text_buffer + len, ": ");
+	if (value < 0) {
+		text_buffer[len++] = '-';
+		value = -value;
+	}
+	len += format_fixed(text_buffer + len, value, unit == DISPLAY_RAW ? 0 : 3);
+	text_buffer[len++] = ' ';
+	format_text(text_buffer + len, accl_unit_text[unit]);
+	/* Update line on display, padding over the previous contents of the line. */
+	display_row(text_buffer, row);
 }
 
 /* Clears the entire display to be blank. */
 void clear_display(void) {
 	uint8_t i;
-	for (i = 0; i < 4; i++) {
-		OLEDStringDraw("                ", 0, i);
+	for (i = 0; i < DISPLAY_ROWS; i++) {
+		display_row("", i);
 	}
 }
 
@@ -70,12 +207,16 @@ void display_goal_reached(uint16_t steps, uint16_t distance, uint16_t goal) {
 	char steps_text_buffer[17];
 	char dist_text_buffer[17];
 	char goal_text_buffer[17];
-	usnprintf(goal_text_buffer, sizeof(goal_text_buffer), "Step Goal: %d", goal);
-	usnprintf(steps_text_buffer, sizeof(steps_text_buffer), "Steps: %d", steps);
-	usnprintf(dist_text_buffer, sizeof(dist_text_buffer), "Km: %1d.%02d",
-			abs(distance / 1000), abs(distance % 1000));
-	OLEDStringDraw("*GOAL COMPLETE*", 0, 0);
-	OLEDStringDraw(steps_text_buffer, 0, 2);
-	OLEDStringDraw(dist_text_buffer, 0, 3);
-	OLEDStringDraw(goal_text_buffer, 0, 1);
+	uint8_t len = format_text(goal_text_buffer, "Step Goal: ");
+	format_uint(goal_text_buffer + len, goal, 0, ' ');
+	len = format_text(steps_text_buffer, "Steps: ");
+	format_uint(steps_text_buffer + len, steps, 0, ' ');
+	/* Distance is in meters, shown as kilometers truncated to two decimal places,
+	 * so 1050m reads 1.05 and 1234m reads 1.23. */
+	len = format_text(dist_text_buffer, "Km: ");
+	format_fixed(dist_text_buffer + len, distance / 10, 2);
+	display_row("*GOAL COMPLETE*", 0);
+	display_row(steps_text_buffer, 2);
+	display_row(dist_text_buffer, 3);
+	display_row(goal_text_buffer, 1);
 }
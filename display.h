@@ -14,9 +14,29 @@
 #ifndef DISPLAY_H
 #define DISPLAY_H
 
+#include "units.h"
+
 /* Initializes the Orbit OLED display */
 void initDisplay(void);
 
+/* Posts text to be drawn starting at the given column and row.
+ * Nothing is sent to the OLED until display_flush is called. */
+void display_string(char *text, uint8_t col, uint8_t row);
+
+/* Draws up to max_chars characters of posted text that differ from what is on the OLED.
+ * Called from a low priority task so display I/O is spread over many calls. */
+void display_flush(uint8_t max_chars);
+
+/* Returns true while posted text is still waiting to be drawn. */
+bool display_busy(void);
+
+/* Blanks the OLED at once. Text can still be posted while blanked, and
+ * all of it is drawn by display_flush after display_unblank. */
+void display_blank(void);
+
+/* Lets display_flush draw the posted text again after display_blank. */
+void display_unblank(void);
+
 /* Update the display on the Orbit OLED display to show step related data. */
 void display_steps(uint32_t value, uint8_t row, char *units);
 
@@ -26,6 +46,10 @@ void display_val(char *prefix, uint32_t value, uint8_t row);
 /* Update the display on the Orbit OLED display in form of "prefix: value units". */
 void display_val_units(char *prefix, uint32_t value, uint8_t row, char *units);
 
+/* Update the display on the Orbit OLED display in form of "prefix: value units",
+ * with a raw accelerometer reading converted to the given unit. */
+void display_accl(char *prefix, int16_t raw, display_unit unit, uint8_t row);
+
 /* Clears the entire display to be blank. */
 void clear_display(void);
 
@@ -0,0 +1,209 @@
+/*
+ * File: dsp.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Kernels for the int16 sample math of the step detector, in plain C and on
+ * packed pairs of int16 for the Cortex-M4 DSP instructions.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp.h"
+
+/* Projects readings onto a unit vector. */
+void dsp_project_c(const int16_t *x, const int16_t *y, const int16_t *z, uint16_t count,
+		const int32_t *unit, uint8_t shift, int32_t *out) {
+	int32_t ux = unit[0];
+	int32_t uy = unit[1];
+	int32_t uz = unit[2];
+	uint16_t i;
+	for (i = 0; i < count; i++) {
+		out[i] = (x[i] * ux + y[i] * uy + z[i] * uz) >> shift;
+	}
+}
+
+/* Slides sums of absolute differences along by one sample. */
+void dsp_slide_amdf_c(uint32_t *sums, uint16_t count, int16_t entering,
+		const int16_t *entering_history, int16_t leaving, const int16_t *leaving_history) {
+	uint16_t k;
+	for (k = 0; k < count; k++) {
+		uint16_t entering_diff = abs(entering - entering_history[-k]);
+		uint16_t leaving_diff = abs(leaving - leaving_history[-k]);
+		sums[k] += entering_diff - leaving_diff;
+	}
+}
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+
+/* The GE bits are kept in the APSR, ge is only used by the emulation. */
+#define SMLAD(a, b, acc) __smlad(a, b, acc)
+#define SSUB16(a, b, ge) ((void) (ge), __ssub16(a, b))
+#define SEL(a, b, ge) ((void) (ge), __sel(a, b))
+
+#else
+
+/* The emulated APSR.GE bits, one per byte, are set by SSUB16 into the caller's ge
+ * and passed on to SEL, so the kernels hold no state between calls. */
+
+/* Both halves multiplied and added to the accumulator, wrapping at 32 bits. */
+static int32_t SMLAD(uint32_t a, uint32_t b, int32_t acc) {
+	int32_t low = (int32_t) (int16_t) a * (int16_t) b;
+	int32_t high = (int32_t) (int16_t) (a >> 16) * (int16_t) (b >> 16);
+	return (int32_t) ((uint32_t) acc + (uint32_t) low + (uint32_t) high);
+}
+
+/* Both halves subtracted, wrapping at 16 bits. The GE bits of a half are set when
+ * its true difference is not negative. */
+static uint32_t SSUB16(uint32_t a, uint32_t b, uint8_t *ge) {
+	int32_t low = (int32_t) (int16_t) a - (int16_t) b;
+	int32_t high = (int32_t) (int16_t) (a >> 16) - (int16_t) (b >> 16);
+	*ge = (low >= 0 ? 0x3 : 0) | (high >= 0 ? 0xC : 0);
+	return ((uint32_t) low & 0xFFFF) | ((uint32_t) high << 16);
+}
+
+/* Each byte from a where its GE bit is set, otherwise from b. */
+static uint32_t SEL(uint32_t a, uint32_t b, const uint8_t *ge) {
+	uint32_t result = 0;
+	uint8_t i;
+	for (i = 0; i < 4; i++) {
+		uint32_t byte = 0xFFu << (8 * i);
+		result |= ((*ge >> i) & 1 ? a : b) & byte;
+	}
+	return result;
+}
+
+#endif
+
+/* Packs two int16 into a word, a in the low half as a load of a then b would. */
+#define PACK(a, b) (((uint32_t) (uint16_t) (a)) | ((uint32_t) (uint16_t) (b) << 16))
+
+/* Loads two consecutive int16, which need not be word aligned on the Cortex-M4. */
+static uint32_t load_pair(const int16_t *p) {
+	uint32_t pair;
+	memcpy(&pair, p, sizeof(pair));
+	return pair;
+}
+
+/* |a - b| of each half as an unsigned 16 bit value, which always holds it. The
+ * second subtract leaves GE set on the halves where a >= b. */
+static uint32_t absolute_difference(uint32_t a, uint32_t b) {
+	uint8_t ge;
+	uint32_t negative = SSUB16(b, a, &ge);
+	uint32_t positive = SSUB16(a, b, &ge);
+	return SEL(positive, negative, &ge);
+}
+
+/* Projects readings onto a unit vector, x and y of a reading packed against the
+ * first two components for one dual multiply accumulate. */
+void dsp_project_packed(const int16_t *x, const int16_t *y, const int16_t *z,
+		uint16_t count, const int32_t *unit, uint8_t shift, int32_t *out) {
+	uint32_t unit_xy = PACK(unit[0], unit[1]);
+	int32_t uz = unit[2];
+	uint16_t i;
+	for (i = 0; i < count; i++) {
+		out[i] = SMLAD(PACK(x[i], y[i]), unit_xy, z[i] * uz) >> shift;
+	}
+}
+
+/* Slides sums of absolute differences along by one sample, two lags at a time.
+ * A pair loaded from k + 1 back holds lag k + 1 in its low half and lag k in its high. */
+void dsp_slide_amdf_packed(uint32_t *sums, uint16_t count, int16_t entering,
+		const int16_t *entering_history, int16_t leaving, const int16_t *leaving_history) {
+	uint32_t entering_pair = PACK(entering, entering);
+	uint32_t leaving_pair = PACK(leaving, leaving);
+	uint16_t k;
+	for (k = 0; k + 1 < count; k += 2) {
+		uint32_t entering_diffs = absolute_difference(entering_pair,
+				load_pair(entering_history - k - 1));
+		uint32_t leaving_diffs = absolute_difference(leaving_pair,
+				load_pair(leaving_history - k - 1));
+		sums[k] += (int32_t) (entering_diffs >> 16) - (int32_t) (leaving_diffs >> 16);
+		sums[k + 1] += (int32_t) (entering_diffs & 0xFFFF) - (int32_t) (leaving_diffs & 0xFFFF);
+	}
+	if (k < count) {
+		dsp_slide_amdf_c(sums + k, 1, entering, entering_history - k, leaving,
+				leaving_history - k);
+	}
+}
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+/* Projects readings onto a unit vector 16 at a time. x and y are interleaved
+ * against the first two components for one multiply add of pairs, and z is
+ * interleaved with zero against the third. */
+void dsp_project_avx2(const int16_t *x, const int16_t *y, const int16_t *z,
+		uint16_t count, const int32_t *unit, uint8_t shift, int32_t *out) {
+	__m256i unit_xy = _mm256_set1_epi32((int32_t) PACK(unit[0], unit[1]));
+	__m256i unit_z = _mm256_set1_epi32((int32_t) PACK(unit[2], 0));
+	__m256i zero = _mm256_setzero_si256();
+	__m128i count_shift = _mm_cvtsi32_si128(shift);
+	uint16_t i;
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m256i vx = _mm256_loadu_si256((const __m256i *) (x + i));
+		__m256i vy = _mm256_loadu_si256((const __m256i *) (y + i));
+		__m256i vz = _mm256_loadu_si256((const __m256i *) (z + i));
+		/* Unpacking works within each 128 bit half, so low holds readings 0-3 and
+		 * 8-11, high holds 4-7 and 12-15. */
+		__m256i low = _mm256_add_epi32(
+				_mm256_madd_epi16(_mm256_unpacklo_epi16(vx, vy), unit_xy),
+				_mm256_madd_epi16(_mm256_unpacklo_epi16(vz, zero), unit_z));
+		__m256i high = _mm256_add_epi32(
+				_mm256_madd_epi16(_mm256_unpackhi_epi16(vx, vy), unit_xy),
+				_mm256_madd_epi16(_mm256_unpackhi_epi16(vz, zero), unit_z));
+		low = _mm256_sra_epi32(low, count_shift);
+		high = _mm256_sra_epi32(high, count_shift);
+		_mm256_storeu_si256((__m256i *) (out + i), _mm256_permute2x128_si256(low, high, 0x20));
+		_mm256_storeu_si256((__m256i *) (out + i + 8), _mm256_permute2x128_si256(low, high, 0x31));
+	}
+	dsp_project_c(x + i, y + i, z + i, count - i, unit, shift, out + i);
+}
+
+/* Loads the 16 int16 ending at p in reverse, so lane j holds p[-j]. */
+static __m256i load_backwards(const int16_t *p) {
+	const __m256i reverse = _mm256_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3,
+			0, 1, 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+	__m256i v = _mm256_loadu_si256((const __m256i *) (p - 15));
+	return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, reverse), 0x4E);
+}
+
+/* |a - b| of each lane as an unsigned 16 bit value, the larger less the smaller
+ * wrapping into the full unsigned range. */
+static __m256i absolute_difference_avx2(__m256i a, __m256i b) {
+	return _mm256_sub_epi16(_mm256_max_epi16(a, b), _mm256_min_epi16(a, b));
+}
+
+/* Slides sums of absolute differences along by one sample, 16 lags at a time. */
+void dsp_slide_amdf_avx2(uint32_t *sums, uint16_t count, int16_t entering,
+		const int16_t *entering_history, int16_t leaving, const int16_t *leaving_history) {
+	__m256i entering_all = _mm256_set1_epi16(entering);
+	__m256i leaving_all = _mm256_set1_epi16(leaving);
+	uint16_t k;
+	for (k = 0; k + 16 <= count; k += 16) {
+		__m256i entering_diffs = absolute_difference_avx2(entering_all,
+				load_backwards(entering_history - k));
+		__m256i leaving_diffs = absolute_difference_avx2(leaving_all,
+				load_backwards(leaving_history - k));
+		__m256i change_low = _mm256_sub_epi32(
+				_mm256_cvtepu16_epi32(_mm256_castsi256_si128(entering_diffs)),
+				_mm256_cvtepu16_epi32(_mm256_castsi256_si128(leaving_diffs)));
+		__m256i change_high = _mm256_sub_epi32(
+				_mm256_cvtepu16_epi32(_mm256_extracti128_si256(entering_diffs, 1)),
+				_mm256_cvtepu16_epi32(_mm256_extracti128_si256(leaving_diffs, 1)));
+		__m256i *low = (__m256i *) (sums + k);
+		__m256i *high = (__m256i *) (sums + k + 8);
+		_mm256_storeu_si256(low, _mm256_add_epi32(_mm256_loadu_si256(low), change_low));
+		_mm256_storeu_si256(high, _mm256_add_epi32(_mm256_loadu_si256(high), change_high));
+	}
+	dsp_slide_amdf_c(sums + k, count - k, entering, entering_history - k, leaving,
+			leaving_history - k);
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * File: dsp.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Kernels for the int16 sample math of the step detector, each in plain C and on
+ * pairs of int16 packed in a word for the Cortex-M4 DSP instructions, which give
+ * bit-identical results. The packed versions use the ACLE intrinsics where the
+ * DSP instructions exist and emulate them in C elsewhere, so they can be checked
+ * against the plain versions on the host. Host builds with AVX2 also get versions
+ * working on 16 int16 at a time, for bulk processing of recorded traces. The
+ * detector uses the packed versions where the DSP instructions exist, or
+ * everywhere if DSP_EMULATE is defined, the AVX2 versions where AVX2 is enabled,
+ * and the plain versions otherwise.
+ */
+
+#ifndef DSP_H
+#define DSP_H
+
+/* Projects readings onto a unit vector with 14 fractional bits, the components of
+ * which must lie within +-2^14, writing (x * ux + y * uy + z * uz) >> shift.
+ * Readings must be within the 13 bit range of the accelerometer. */
+void dsp_project_c(const int16_t *x, const int16_t *y, const int16_t *z, uint16_t count,
+		const int32_t *unit, uint8_t shift, int32_t *out);
+
+/* Slides sums of absolute differences along by one sample. For each k below count,
+ * sums[k] gains |entering - entering_history[-k]| and loses |leaving - leaving_history[-k]|,
+ * the histories being read backwards from the pointers given. Sums wrap at 2^32. */
+void dsp_slide_amdf_c(uint32_t *sums, uint16_t count, int16_t entering,
+		const int16_t *entering_history, int16_t leaving, const int16_t *leaving_history);
+
+/* The same kernels on packed pairs, a dual multiply accumulate per reading for the
+ * projection and a dual subtract and select per two lags for the differences. */
+void dsp_project_packed(const int16_t *x, const int16_t *y, const int16_t *z,
+		uint16_t count, const int32_t *unit, uint8_t shift, int32_t *out);
+void dsp_slide_amdf_packed(uint32_t *sums, uint16_t count, int16_t entering,
+		const int16_t *entering_history, int16_t leaving, const int16_t *leaving_history);
+
+#if defined(__AVX2__)
+/* The same kernels on vectors of 16 int16, 16 readings per projection and 16
+ * lags per difference. */
+void dsp_project_avx2(const int16_t *x, const int16_t *y, const int16_t *z,
+		uint16_t count, const int32_t *unit, uint8_t shift, int32_t *out);
+void dsp_slide_amdf_avx2(uint32_t *sums, uint16_t count, int16_t entering,
+		const int16_t *entering_history, int16_t leaving, const int16_t *leaving_history);
+#endif
+
+#if (defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP) || defined(DSP_EMULATE)
+#define dsp_project dsp_project_packed
+#define dsp_slide_amdf dsp_slide_amdf_packed
+#elif defined(__AVX2__)
+#define dsp_project dsp_project_avx2
+#define dsp_slide_amdf dsp_slide_amdf_avx2
+#else
+#define dsp_project dsp_project_c
+#define dsp_slide_amdf dsp_slide_amdf_c
+#endif
+
+#endif /* DSP_H */
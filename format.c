@@ -0,0 +1,89 @@
+/*
+ * File: format.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Small integer to text formatting used by the display. Replaces usnprintf for
+ * the few formats the display needs without parsing a format string or using varargs.
+ */
+
+#include <stdint.h>
+
+#include "format.h"
+
+/* Every number from 00 to 99 as two characters so two digits are produced per divide. */
+static const char digit_pairs[201] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+static const uint32_t powers_of_ten[FORMAT_UINT_MAX_LEN] = { 1, 10, 100, 1000,
+		10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+/* Writes the digits of value to the end of a buffer, returning a pointer to the first digit. */
+static char *write_digits_backwards(char *end, uint32_t value) {
+	while (value >= 100) {
+		uint32_t pair = (value % 100) * 2;
+		value /= 100;
+		*--end = digit_pairs[pair + 1];
+		*--end = digit_pairs[pair];
+	}
+	if (value >= 10) {
+		*--end = digit_pairs[value * 2 + 1];
+		*--end = digit_pairs[value * 2];
+	} else {
+		*--end = '0' + value;
+	}
+	return end;
+}
+
+/* Writes value in decimal, padded on the left with pad up to min_width characters. */
+uint8_t format_uint(char *buf, uint32_t value, uint8_t min_width, char pad) {
+	char digits[FORMAT_UINT_MAX_LEN];
+	char *start = write_digits_backwards(digits + FORMAT_UINT_MAX_LEN, value);
+	uint8_t num_digits = digits + FORMAT_UINT_MAX_LEN - start;
+	uint8_t len = 0;
+	while (len + num_digits < min_width) {
+		buf[len++] = pad;
+	}
+	uint8_t i;
+	for (i = 0; i < num_digits; i++) {
+		buf[len++] = start[i];
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+/* Writes value as a fixed point number with the given number of decimal places. */
+uint8_t format_fixed(char *buf, uint32_t value, uint8_t decimals) {
+	if (decimals == 0) {
+		return format_uint(buf, value, 0, ' ');
+	}
+	if (decimals >= FORMAT_UINT_MAX_LEN) {
+		decimals = FORMAT_UINT_MAX_LEN - 1;
+	}
+	uint32_t scale = powers_of_ten[decimals];
+	uint8_t len = format_uint(buf, value / scale, 0, ' ');
+	buf[len++] = '.';
+	return len + format_uint(buf + len, value % scale, decimals, '0');
+}
+
+/* Copies text into buf, used to add prefixes and unit suffixes. */
+uint8_t format_text(char *buf, const char *text) {
+	uint8_t len = 0;
+	while (text[len] != '\0') {
+		buf[len] = text[len];
+		len++;
+	}
+	buf[len] = '\0';
+	return len;
+}
@@ -0,0 +1,31 @@
+/*
+ * File: format.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Small integer to text formatting used by the display. Replaces usnprintf for
+ * the few formats the display needs without parsing a format string or using varargs.
+ */
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+/* Largest number of characters format_uint can write, not including the terminator. */
+#define FORMAT_UINT_MAX_LEN 10
+
+/* Writes value in decimal, padded on the left with pad up to min_width characters.
+ * The text is NUL terminated and the number of characters written is returned. */
+uint8_t format_uint(char *buf, uint32_t value, uint8_t min_width, char pad);
+
+/* Writes value as a fixed point number with the given number of decimal places,
+ * e.g. 1234 with 3 decimals is "1.234" and 5 with 2 decimals is "0.05".
+ * The text is NUL terminated and the number of characters written is returned. */
+uint8_t format_fixed(char *buf, uint32_t value, uint8_t decimals);
+
+/* Copies text into buf, used to add prefixes and unit suffixes.
+ * The text is NUL terminated and the number of characters written is returned. */
+uint8_t format_text(char *buf, const char *text);
+
+#endif /* FORMAT_H */
@@ -0,0 +1,72 @@
+/*
+ * File: gait_gate.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Walking detection from a bank of Goertzel filters at gait frequencies.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gait_gate.h"
+
+/* Smallest swing of the scaled signal at a gait frequency that counts as walking.
+ * 8 units is ~0.03g, well below the lightest walk and well above sensor noise. */
+#define GAIT_GATE_MIN_AMPLITUDE 8
+
+/* Initializes the gate closed. */
+void init_gait_gate(gait_gate_t *gate, const int32_t *coefs, uint16_t block) {
+	uint8_t i;
+	for (i = 0; i < GAIT_GATE_BINS; i++) {
+		init_goertzel(&gate->bins[i], coefs[i]);
+	}
+	/* A sinusoid of amplitude A on a bin has magnitude A * n / 2 over a block of n. */
+	uint32_t min_magnitude = (uint32_t) GAIT_GATE_MIN_AMPLITUDE * block / 2;
+	gate->threshold = (uint64_t) min_magnitude * min_magnitude;
+	gate->block = block;
+	gate->hold = 0;
+	gate->open = false;
+}
+
+/* Opens the gate on a block with gait, otherwise lets it close once the hold is over. */
+static void end_block(gait_gate_t *gate, bool gait) {
+	if (gait) {
+		gate->open = true;
+		gate->hold = GAIT_GATE_HOLD_BLOCKS;
+	} else if (gate->hold > 0) {
+		gate->hold--;
+	} else {
+		gate->open = false;
+	}
+}
+
+/* Updates the gate from a whole block of the step signal. */
+void update_gait_gate(gait_gate_t *gate, const int32_t *signal) {
+	uint16_t n;
+	uint8_t i;
+	for (n = 0; n < gate->block; n++) {
+		for (i = 0; i < GAIT_GATE_BINS; i++) {
+			update_goertzel(&gate->bins[i], signal[n] >> GAIT_GATE_INPUT_SHIFT);
+		}
+	}
+	bool gait = false;
+	for (i = 0; i < GAIT_GATE_BINS; i++) {
+		if (end_goertzel_block(&gate->bins[i]) > gate->threshold) {
+			gait = true;
+		}
+	}
+	end_block(gate, gait);
+}
+
+/* Updates the gate for a block known to have no motion. */
+void skip_gait_gate(gait_gate_t *gate) {
+	end_block(gate, false);
+}
+
+/* Returns true while walking or running, and for a short hold after it stops. */
+bool gait_gate_open(const gait_gate_t *gate) {
+	return gate->open;
+}
@@ -0,0 +1,67 @@
+/*
+ * File: gait_gate.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Walking detection from a bank of Goertzel filters at gait frequencies, used to
+ * skip the step detector while the wearer is not moving. The step signal is
+ * split into blocks of 2 seconds so the bins fall on whole multiples of 0.5Hz,
+ * and each block's power at 1Hz to 3Hz is compared against a threshold.
+ * A constant input such as gravity has no power in any bin.
+ * Blocks are analysed whole once collected, and blocks without any motion can be
+ * passed over without running the filters at all.
+ */
+
+#ifndef GAIT_GATE_H
+#define GAIT_GATE_H
+
+#include "goertzel.h"
+
+/* Samples per block at sample rate fs, 2 seconds. */
+#define GAIT_GATE_BLOCK(fs) ((fs) * 2)
+
+/* Bins at 1, 1.5, 2, 2.5 and 3Hz, the step frequencies from a slow walk to a run. */
+#define GAIT_GATE_BINS 5
+#define GAIT_GATE_FIRST_BIN 2
+
+/* The signal is scaled down by 2^GAIT_GATE_INPUT_SHIFT to stay in range of the
+ * filters, leaving 256 units per g at full resolution. */
+#define GAIT_GATE_INPUT_SHIFT 8
+
+/* Blocks the gate stays open after the last with gait, so pauses such as waiting
+ * to cross the road do not lose the steps on either side. */
+#define GAIT_GATE_HOLD_BLOCKS 2
+
+/* Coefficients of the bins for sample rate fs, to initialize a constant array. */
+#define GAIT_GATE_COEFS(fs) { \
+	GOERTZEL_COEF(GAIT_GATE_FIRST_BIN, GAIT_GATE_BLOCK(fs)), \
+	GOERTZEL_COEF(GAIT_GATE_FIRST_BIN + 1, GAIT_GATE_BLOCK(fs)), \
+	GOERTZEL_COEF(GAIT_GATE_FIRST_BIN + 2, GAIT_GATE_BLOCK(fs)), \
+	GOERTZEL_COEF(GAIT_GATE_FIRST_BIN + 3, GAIT_GATE_BLOCK(fs)), \
+	GOERTZEL_COEF(GAIT_GATE_FIRST_BIN + 4, GAIT_GATE_BLOCK(fs)) }
+
+typedef struct {
+	goertzel_t bins[GAIT_GATE_BINS];
+	uint64_t threshold;  /* Bin power that counts as gait over a whole block. */
+	uint16_t block;      /* Samples per block. */
+	uint8_t hold;        /* Blocks the gate stays open for without gait. */
+	bool open;
+} gait_gate_t;
+
+/* Initializes the gate closed, with coefficients from GAIT_GATE_COEFS for the
+ * same sample rate as block. */
+void init_gait_gate(gait_gate_t *gate, const int32_t *coefs, uint16_t block);
+
+/* Updates the gate from a whole block of the step signal, in full resolution
+ * units with 8 fractional bits. */
+void update_gait_gate(gait_gate_t *gate, const int32_t *signal);
+
+/* Updates the gate for a block known to have no motion, without filtering it. */
+void skip_gait_gate(gait_gate_t *gate);
+
+/* Returns true while walking or running, and for a short hold after it stops. */
+bool gait_gate_open(const gait_gate_t *gate);
+
+#endif /* GAIT_GATE_H */
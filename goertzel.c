@@ -0,0 +1,39 @@
+/*
+ * File: goertzel.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Goertzel filters in fixed point with a 64 bit product per sample.
+ */
+
+#include <stdint.h>
+
+#include "goertzel.h"
+
+/* Initializes a filter with a coefficient from GOERTZEL_COEF. */
+void init_goertzel(goertzel_t *filter, int32_t coef) {
+	filter->coef = coef;
+	filter->s1 = 0;
+	filter->s2 = 0;
+}
+
+/* Filters one sample of the block. */
+void update_goertzel(goertzel_t *filter, int32_t input) {
+	int32_t s0 = input + (int32_t) (((int64_t) filter->coef * filter->s1
+			+ (1 << (GOERTZEL_COEF_BITS - 1))) >> GOERTZEL_COEF_BITS) - filter->s2;
+	filter->s2 = filter->s1;
+	filter->s1 = s0;
+}
+
+/* Returns the squared magnitude of the bin and resets the filter. */
+uint64_t end_goertzel_block(goertzel_t *filter) {
+	int64_t s1 = filter->s1;
+	int64_t s2 = filter->s2;
+	int64_t cross = ((filter->coef * s1 + (1 << (GOERTZEL_COEF_BITS - 1))) >> GOERTZEL_COEF_BITS) * s2;
+	int64_t power = s1 * s1 + s2 * s2 - cross;
+	filter->s1 = 0;
+	filter->s2 = 0;
+	return power > 0 ? (uint64_t) power : 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * File: goertzel.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Goertzel filters in fixed point, measuring the power of a single frequency
+ * over a block of samples with one multiply per sample. Coefficients are Q30
+ * and generated by the compiler like the biquad coefficients.
+ */
+
+#ifndef GOERTZEL_H
+#define GOERTZEL_H
+
+#include "const_trig.h"
+
+/* Fractional bits of the coefficient. Q30 holds 2cos(w) for any frequency above 0. */
+#define GOERTZEL_COEF_BITS 30
+
+/* Coefficient for bin k of a block of n samples, the frequency k * fs / n. */
+#define GOERTZEL_COEF(k, n) \
+	((int32_t) (2 * CONST_COS(2 * CONST_PI * (k) / (n)) * (1 << GOERTZEL_COEF_BITS) \
+			+ (CONST_COS(2 * CONST_PI * (k) / (n)) >= 0 ? 0.5 : -0.5)))
+
+typedef struct {
+	int32_t coef;
+	int32_t s1; /* Previous two filter states. */
+	int32_t s2;
+} goertzel_t;
+
+/* Initializes a filter with a coefficient from GOERTZEL_COEF, ready for a block. */
+void init_goertzel(goertzel_t *filter, int32_t coef);
+
+/* Filters one sample of the block. Inputs should stay within +-2^15 for
+ * blocks of up to 256 samples. */
+void update_goertzel(goertzel_t *filter, int32_t input);
+
+/* Returns the squared magnitude of the bin over the samples since the last
+ * reset and resets the filter for the next block. */
+uint64_t end_goertzel_block(goertzel_t *filter);
+
+#endif /* GOERTZEL_H */
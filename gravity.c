@@ -0,0 +1,130 @@
+/*
+ * File: gravity.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Tracks the direction of gravity and projects each reading onto it.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "accelerometer.h"
+#include "gravity.h"
+#include "dsp.h"
+
+/* Returns the length of a vector, rounded down. The square root is taken a bit
+ * of the root at a time, from the highest, so no floating point is needed. */
+uint32_t gravity_norm(int32_t x, int32_t y, int32_t z) {
+	uint64_t remainder = (uint64_t) ((int64_t) x * x) + (uint64_t) ((int64_t) y * y)
+			+ (uint64_t) ((int64_t) z * z);
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t) 1 << 62;
+	while (bit > remainder) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (remainder >= root + bit) {
+			remainder -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t) root;
+}
+
+/* Renews the unit vector from the average gravity. The one square root and
+ * the divides are spread over a block of samples. */
+static void update_unit(gravity_t *tracker) {
+	uint8_t i;
+	int32_t norm = gravity_norm(tracker->gravity[0], tracker->gravity[1], tracker->gravity[2]);
+	if (norm < (GRAVITY_MIN_NORM << GRAVITY_FRAC_BITS)) {
+		return;
+	}
+	for (i = 0; i < 3; i++) {
+		tracker->unit[i] = (int64_t) tracker->gravity[i] * (1 << GRAVITY_UNIT_BITS) / norm;
+	}
+}
+
+/* Initializes gravity as the given reading. */
+void init_gravity(gravity_t *tracker, vector3_t rest, uint8_t shift) {
+	tracker->gravity[0] = rest.x * (1 << GRAVITY_FRAC_BITS);
+	tracker->gravity[1] = rest.y * (1 << GRAVITY_FRAC_BITS);
+	tracker->gravity[2] = rest.z * (1 << GRAVITY_FRAC_BITS);
+	/* Straight down the z axis, as the device lies flat, if the reading gives no direction. */
+	tracker->unit[0] = 0;
+	tracker->unit[1] = 0;
+	tracker->unit[2] = 1 << GRAVITY_UNIT_BITS;
+	update_unit(tracker);
+	tracker->count = 0;
+	tracker->shift = shift;
+}
+
+/* Feeds one reading, returning its acceleration along gravity. */
+int32_t update_gravity(gravity_t *tracker, vector3_t acceleration) {
+	int32_t axes[3] = { acceleration.x, acceleration.y, acceleration.z };
+	int32_t dot = 0;
+	uint8_t i;
+	for (i = 0; i < 3; i++) {
+		tracker->gravity[i] += (axes[i] * (1 << GRAVITY_FRAC_BITS) - tracker->gravity[i]) >> tracker->shift;
+		dot += axes[i] * tracker->unit[i];
+	}
+	tracker->count++;
+	if (tracker->count == GRAVITY_UNIT_BLOCK) {
+		tracker->count = 0;
+		update_unit(tracker);
+	}
+	return dot >> (GRAVITY_UNIT_BITS - GRAVITY_FRAC_BITS);
+}
+
+/* Runs the average of one axis over a block of readings. */
+static int32_t average_axis(int32_t average, const int16_t *axis, uint16_t count,
+		uint8_t shift) {
+	uint16_t i;
+	for (i = 0; i < count; i++) {
+		average += (axis[i] * (1 << GRAVITY_FRAC_BITS) - average) >> shift;
+	}
+	return average;
+}
+
+/* Feeds a block of readings, writing their acceleration along gravity. */
+void update_gravity_block(gravity_t *tracker, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint16_t count, int32_t *vertical) {
+	while (count > 0) {
+		uint16_t n = GRAVITY_UNIT_BLOCK - tracker->count;
+		if (n > count) {
+			n = count;
+		}
+		/* The unit vector is fixed up to its next renewal, so the projections have
+		 * no dependency between readings. */
+		dsp_project(x, y, z, n, tracker->unit, GRAVITY_UNIT_BITS - GRAVITY_FRAC_BITS,
+				vertical);
+		tracker->gravity[0] = average_axis(tracker->gravity[0], x, n, tracker->shift);
+		tracker->gravity[1] = average_axis(tracker->gravity[1], y, n, tracker->shift);
+		tracker->gravity[2] = average_axis(tracker->gravity[2], z, n, tracker->shift);
+
+		tracker->count += n;
+		if (tracker->count == GRAVITY_UNIT_BLOCK) {
+			tracker->count = 0;
+			update_unit(tracker);
+		}
+		x += n;
+		y += n;
+		z += n;
+		vertical += n;
+		count -= n;
+	}
+}
+
+/* Returns the average gravity in raw units. */
+vector3_t gravity_average(const gravity_t *tracker) {
+	vector3_t average;
+	average.x = tracker->gravity[0] >> GRAVITY_FRAC_BITS;
+	average.y = tracker->gravity[1] >> GRAVITY_FRAC_BITS;
+	average.z = tracker->gravity[2] >> GRAVITY_FRAC_BITS;
+	return average;
+}
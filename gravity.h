@@ -0,0 +1,59 @@
+/*
+ * File: gravity.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Tracks the direction of gravity and projects each reading onto it, giving the
+ * vertical acceleration whichever way the device is worn. Gravity is a slow
+ * exponential average of each axis, and its unit vector is renewed once per
+ * block of samples so the projection of each sample is three multiplies with no
+ * square root or divide. Requires accelerometer.h to be included first.
+ */
+
+#ifndef GRAVITY_H
+#define GRAVITY_H
+
+/* Fractional bits of the gravity vector and of the vertical acceleration. */
+#define GRAVITY_FRAC_BITS 8
+
+/* Fractional bits of the unit vector along gravity. */
+#define GRAVITY_UNIT_BITS 14
+
+/* Samples between renewals of the unit vector. Gravity turns by well under a
+ * degree in this time, so the projection error is negligible. */
+#define GRAVITY_UNIT_BLOCK 16
+
+/* Gravity shorter than this, in raw units, is too short to give a direction,
+ * such as in free fall, and the previous direction is kept. */
+#define GRAVITY_MIN_NORM 64
+
+typedef struct {
+	int32_t gravity[3];  /* Average x, y and z with GRAVITY_FRAC_BITS. */
+	int32_t unit[3];     /* Unit vector along gravity with GRAVITY_UNIT_BITS. */
+	uint8_t count;       /* Samples since the unit vector was renewed. */
+	uint8_t shift;       /* Each axis follows roughly the last 2^shift samples. */
+} gravity_t;
+
+/* Initializes gravity as the given reading, taken while the device is at rest.
+ * The average follows roughly the last 2^shift samples. */
+void init_gravity(gravity_t *tracker, vector3_t rest, uint8_t shift);
+
+/* Feeds one reading, returning its acceleration along gravity in raw units with
+ * GRAVITY_FRAC_BITS. At rest this is the magnitude of gravity. */
+int32_t update_gravity(gravity_t *tracker, vector3_t acceleration);
+
+/* Feeds count readings given as separate x, y and z arrays, writing the
+ * acceleration of each along gravity to vertical. Gives the same results as
+ * update_gravity on each reading in turn, in loops the compiler can unroll. */
+void update_gravity_block(gravity_t *tracker, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint16_t count, int32_t *vertical);
+
+/* Returns the average gravity in raw units. */
+vector3_t gravity_average(const gravity_t *tracker);
+
+/* Returns the length of the vector (x, y, z), rounded down, in integer math. */
+uint32_t gravity_norm(int32_t x, int32_t y, int32_t z);
+
+#endif /* GRAVITY_H */
@@ -19,11 +19,22 @@
 #include "driverlib/sysctl.h"
 
 #include "ui.h"
+#include "power.h"
 
 /* Flag to keep track of the most recent switch state to check
  * whether the switch has been flip. */
 static int32_t last_switch_state;
 
+/* Returns the change in a button since the last check, restarting the
+ * sleep timeout if it was pushed or released. */
+static uint8_t check_button(uint8_t button) {
+	uint8_t change = checkButton(button);
+	if (change != NO_CHANGE) {
+		power_user_activity();
+	}
+	return change;
+}
+
 /* Returns true if the button is a long press (2 seconds). */
 static bool is_long_press(uint8_t button) {
 	uint16_t tick = 0;
@@ -42,7 +53,7 @@ static bool is_long_press(uint8_t button) {
 
 /* When the up button is pushed, cycle through the units to display. */
 static void handle_button_up(void) {
-	switch (checkButton(UP)) {
+	switch (check_button(UP)) {
 	case PUSHED:
 		change_step_units();
 		break;
@@ -54,7 +65,7 @@ static void handle_button_up(void) {
 /* When the down button is pushed handle behaviour depending on mode.
  * Used to set goal while in set goal state and not in test state. */
 static void handle_button_down(void) {
-	switch (checkButton(DOWN)) {
+	switch (check_button(DOWN)) {
 	case PUSHED:
 		if (get_ui_state() == SET_GOAL) {
 			set_goal_potentiometer();
@@ -69,7 +80,7 @@ static void handle_button_down(void) {
 
 /* When the left button is pushed, cycle previous through UI states. */
 static void handle_button_left(void) {
-	switch (checkButton(LEFT)) {
+	switch (check_button(LEFT)) {
 	case PUSHED:
 		prev_ui_state();
 		break;
@@ -80,7 +91,7 @@ static void handle_button_left(void) {
 
 /* When the right button is pushed, cycle next through UI states. */
 static void handle_button_right(void) {
-	switch (checkButton(RIGHT)) {
+	switch (check_button(RIGHT)) {
 	case PUSHED:
 		next_ui_state();
 		break;
@@ -95,6 +106,7 @@ static void handle_switch_1(void) {
 	int32_t current_state = GPIOPinRead(GPIO_PORTA_BASE, GPIO_PIN_7);
 	if (current_state != last_switch_state) {
 		last_switch_state = current_state;
+		power_user_activity();
 		toggle_test_mode();
 	}
 }
@@ -102,7 +114,7 @@ static void handle_switch_1(void) {
 /* When the up button is pushed then increment the steps.
  * This should only be called in test mode. */
 static void handle_button_up_test(void) {
-	switch (checkButton(UP)) {
+	switch (check_button(UP)) {
 	case PUSHED:
 		test_increment();
 		break;
@@ -114,7 +126,7 @@ static void handle_button_up_test(void) {
 /* When the down button is pushed then decrement the steps.
  * This should only be called in test mode. */
 static void handle_button_down_test(void) {
-	switch (checkButton(DOWN)) {
+	switch (check_button(DOWN)) {
 	case PUSHED:
 		test_decrement();
 		break;
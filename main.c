@@ -26,18 +26,24 @@
 #include "input.h"
 #include "display.h"
 #include "ui.h"
+#include "power.h"
 
-/* SAMPLE_RATE_HZ = 2 * BUF_SIZE (12) * max frequency (50Hz)
- * Nyquist theorem */
+/* SysTick rate the tasks below are scheduled from. A multiple of every
+ * accelerometer output data rate, so steps are sampled at exactly
+ * get_accl_sample_rate(), 48 ticks apart at the slowest 25Hz. */
 #define SAMPLE_RATE_HZ 1200
 
 /* Can be used to schedule events. */
 static uint32_t sample_count;
 static uint8_t display_tick;
-static uint16_t step_check_tick;
 static uint8_t step_count_tick;
 static uint8_t button_tick;
 static uint8_t ui_task_tick;
+static uint8_t display_flush_tick;
+
+/* Characters sent to the OLED per display flush, small enough that
+ * the SPI transfer never holds up the sampling tasks. */
+#define DISPLAY_FLUSH_CHARS 4
 
 /* Used to increment sample count and other task counts to keep track of tasks. */
 static void sys_tick_int_handler(void) {
@@ -46,11 +52,11 @@ static void sys_tick_int_handler(void) {
 	if (1 > 0xFFFFFFFF - sample_count) {
 		sample_count = 0;
 	}
-	step_check_tick++;
 	display_tick++;
 	step_count_tick++;
 	button_tick++;
 	ui_task_tick++;
+	display_flush_tick++;
 }
 
 /* Initialize clock and interrupts and set the clock rate to 20 MHz. */
@@ -70,6 +76,7 @@ int main(void) {
 	initAccl();
 	init_inputs();
 	init_ui();
+	init_power();
 
 	/* Enable interrupts to the processor. */
 	IntMasterEnable();
@@ -87,23 +94,31 @@ int main(void) {
 			ui_task_tick = 0;
 		}
 
-		/* Update display at 12Hz */
+		/* Check for display changes at 12Hz, only redrawn when the shown data changed */
 		if (display_tick >= 100) {
 			display_ui();
 			display_tick = 0;
 		}
 
-		/* Check if the step goal has been reached at 4Hz */
-		if (step_check_tick >= 300) {
-			check_step_goal();
-			step_check_tick = 0;
+		/* Pick up activity and inactivity raised by the accelerometer */
+		handle_accl_events();
+
+		/* Sleep once the wearer has been still for a while, until there is something to do */
+		if (update_power() == POWER_SLEEP) {
+			continue;
 		}
 
-		/* Sample for steps at 50Hz */
-		if (step_count_tick >= 24 && !is_test_mode()) {
-		    /* Duration threshold is ~0.2 seconds. */
-			handle_step_event(5);
+		/* Sample for steps at the accelerometer output data rate, unless the wearer is still */
+		if (step_count_tick >= SAMPLE_RATE_HZ / get_accl_sample_rate() && !is_test_mode()
+				&& !accl_idle()) {
+			handle_step_event();
 			step_count_tick = 0;
 		}
+
+		/* Lowest priority, drain posted display text a few characters at a time at 600Hz */
+		if (display_flush_tick >= 2) {
+			display_flush(DISPLAY_FLUSH_CHARS);
+			display_flush_tick = 0;
+		}
 	}
 }
@@ -0,0 +1,60 @@
+/*
+ * File: motion_gate.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * First stage of step detection, a cheap check for any motion at all.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "motion_gate.h"
+
+/* Initializes the gate closed. */
+void init_motion_gate(motion_gate_t *gate, int32_t rest, int32_t threshold,
+		uint16_t hold) {
+	gate->baseline = rest;
+	gate->threshold = threshold;
+	gate->hold = hold;
+	gate->remaining = 0;
+}
+
+/* Feeds one sample of the signal. */
+bool update_motion_gate(motion_gate_t *gate, int32_t value) {
+	int32_t deviation = value - gate->baseline;
+	gate->baseline += deviation >> MOTION_BASELINE_SHIFT;
+	if ((deviation < 0 ? -deviation : deviation) > gate->threshold) {
+		gate->remaining = gate->hold;
+		return true;
+	}
+	if (gate->remaining > 0) {
+		gate->remaining--;
+		return true;
+	}
+	return false;
+}
+
+/* Feeds a block of samples of the signal, with the gate kept in locals. */
+bool update_motion_gate_block(motion_gate_t *gate, const int32_t *values, uint16_t count) {
+	int32_t baseline = gate->baseline;
+	uint16_t remaining = gate->remaining;
+	bool motion = false;
+	uint16_t i;
+	for (i = 0; i < count; i++) {
+		int32_t deviation = values[i] - baseline;
+		baseline += deviation >> MOTION_BASELINE_SHIFT;
+		if ((deviation < 0 ? -deviation : deviation) > gate->threshold) {
+			remaining = gate->hold;
+			motion = true;
+		} else if (remaining > 0) {
+			remaining--;
+			motion = true;
+		}
+	}
+	gate->baseline = baseline;
+	gate->remaining = remaining;
+	return motion;
+}
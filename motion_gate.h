@@ -0,0 +1,43 @@
+/*
+ * File: motion_gate.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * First stage of step detection, a check of a few integer operations per sample
+ * for any motion at all. The step signal is compared against a slow average of
+ * itself, which is gravity while the device is at rest, and a deviation beyond
+ * a loose threshold holds the gate open for a window of samples.
+ * Only windows with motion are passed on to the gait gate and step detector.
+ */
+
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+/* The baseline follows roughly the last 2^MOTION_BASELINE_SHIFT samples, slow
+ * enough that it stays near gravity while walking and fast enough to follow
+ * a change of orientation or temperature drift. */
+#define MOTION_BASELINE_SHIFT 7
+
+typedef struct {
+	int32_t baseline;     /* Slow average of the signal. */
+	int32_t threshold;    /* Deviation from the baseline that counts as motion. */
+	uint16_t hold;        /* Samples the gate stays open for after motion. */
+	uint16_t remaining;   /* Samples left before the gate closes. */
+} motion_gate_t;
+
+/* Initializes the gate closed with the signal expected at rest, and the threshold
+ * in the same units. */
+void init_motion_gate(motion_gate_t *gate, int32_t rest, int32_t threshold,
+		uint16_t hold);
+
+/* Feeds one sample of the signal. Returns true while there has been motion
+ * within the hold window. */
+bool update_motion_gate(motion_gate_t *gate, int32_t value);
+
+/* Feeds count samples of the signal. Returns true if any of them was within the
+ * hold window of motion, the same as update_motion_gate on each in turn. */
+bool update_motion_gate_block(motion_gate_t *gate, const int32_t *values, uint16_t count);
+
+#endif /* MOTION_GATE_H */
@@ -0,0 +1,85 @@
+/*
+ * File: peak_detector.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Step detection by picking peaks of the filtered magnitude with a refractory
+ * period that adapts to the cadence.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "peak_detector.h"
+
+/* Initializes the detector with the range of step intervals in samples. */
+void init_peak_detector(peak_detector_t *detector, uint16_t min_interval,
+		uint16_t max_interval) {
+	detector->previous = 0;
+	detector->previous_above = false;
+	detector->rising = false;
+	detector->since_step = UINT16_MAX;
+	detector->interval = 0;
+	detector->min_interval = min_interval;
+	detector->max_interval = max_interval;
+}
+
+/* Returns the number of samples after a step that another step is ignored for.
+ * This is 5/8 of the smoothed step interval, which is well clear of the bounce
+ * within a step but still lets the cadence speed up. Until the interval is known
+ * the shortest allowed interval is used. */
+static uint16_t refractory_period(const peak_detector_t *detector) {
+	if (detector->interval == 0) {
+		return detector->min_interval;
+	}
+	uint16_t period = (detector->interval * 5) >> (PEAK_INTERVAL_FRAC_BITS + 3);
+	return period > detector->min_interval ? period : detector->min_interval;
+}
+
+/* Feeds one filtered sample and whether it is above the step threshold. */
+bool update_peak_detector(peak_detector_t *detector, int32_t value, bool above_threshold) {
+	bool step = false;
+	if (detector->since_step < UINT16_MAX) {
+		detector->since_step++;
+	}
+	/* The previous sample is a peak if the signal rose into it and falls after it. */
+	bool peak = detector->rising && value < detector->previous && detector->previous_above;
+	if (peak && detector->since_step > refractory_period(detector)) {
+		/* The peak was one sample ago. */
+		uint16_t interval = detector->since_step - 1;
+		if (interval <= detector->max_interval) {
+			uint16_t scaled = interval << PEAK_INTERVAL_FRAC_BITS;
+			if (detector->interval == 0) {
+				detector->interval = scaled;
+			} else {
+				detector->interval += ((int32_t) scaled - detector->interval) >> PEAK_INTERVAL_SHIFT;
+			}
+		}
+		detector->since_step = 1;
+		step = true;
+	}
+	/* Forget the cadence after a long pause, the next walk may be at a different pace. */
+	if (detector->since_step > detector->max_interval) {
+		detector->interval = 0;
+	}
+	if (value != detector->previous) {
+		detector->rising = value > detector->previous;
+	}
+	detector->previous = value;
+	detector->previous_above = above_threshold;
+	return step;
+}
+
+/* Caps the smoothed step interval at an interval measured some other way. */
+void limit_peak_interval(peak_detector_t *detector, uint16_t interval) {
+	if (detector->interval > interval) {
+		detector->interval = interval;
+	}
+}
+
+/* Returns the smoothed step interval in samples, or 0 if it is not known. */
+uint16_t peak_step_interval(const peak_detector_t *detector) {
+	return detector->interval;
+}
@@ -0,0 +1,52 @@
+/*
+ * File: peak_detector.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Step detection by picking peaks of the filtered magnitude. A step is a local
+ * maximum above the threshold that comes at least a refractory period after the
+ * last step. The refractory period follows the measured step interval, so a
+ * second bounce within one step is ignored at any cadence. Each sample is
+ * handled in constant time with no look back over past samples.
+ */
+
+#ifndef PEAK_DETECTOR_H
+#define PEAK_DETECTOR_H
+
+/* Fractional bits of the smoothed step interval. */
+#define PEAK_INTERVAL_FRAC_BITS 4
+
+/* The smoothed interval moves 1/2^PEAK_INTERVAL_SHIFT of the way to each new interval. */
+#define PEAK_INTERVAL_SHIFT 2
+
+typedef struct {
+	int32_t previous;        /* Last sample value. */
+	bool previous_above;     /* Last sample was above the threshold. */
+	bool rising;             /* Last sample was higher than the one before it. */
+	uint16_t since_step;     /* Samples since the last step, saturating. */
+	uint16_t interval;       /* Smoothed step interval in samples with PEAK_INTERVAL_FRAC_BITS, 0 if unknown. */
+	uint16_t min_interval;   /* Shortest step interval in samples, the fastest cadence allowed. */
+	uint16_t max_interval;   /* Longest step interval in samples before walking is considered stopped. */
+} peak_detector_t;
+
+/* Initializes the detector with the range of step intervals in samples. */
+void init_peak_detector(peak_detector_t *detector, uint16_t min_interval,
+		uint16_t max_interval);
+
+/* Feeds one filtered sample and whether it is above the step threshold.
+ * Returns true when the previous sample was a step peak. */
+bool update_peak_detector(peak_detector_t *detector, int32_t value, bool above_threshold);
+
+/* Caps the smoothed step interval at an interval measured some other way, in samples
+ * with PEAK_INTERVAL_FRAC_BITS fractional bits. When the cadence jumps up the
+ * refractory period of the old cadence can hide every other step, and the interval
+ * then settles on two steps unless something that sees every step pulls it back. */
+void limit_peak_interval(peak_detector_t *detector, uint16_t interval);
+
+/* Returns the smoothed step interval in samples with PEAK_INTERVAL_FRAC_BITS fractional
+ * bits, or 0 if the wearer has not taken enough steps recently to measure it. */
+uint16_t peak_step_interval(const peak_detector_t *detector);
+
+#endif /* PEAK_DETECTOR_H */
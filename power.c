@@ -0,0 +1,202 @@
+/*
+ * File: power.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Module for putting the fitness monitor into deep sleep while the wearer is still.
+ * The monitor is active while sampling for steps, idle while the accelerometer
+ * reports the wearer still, and asleep once it has been idle for the sleep timeout
+ * without a button being used. Asleep, the display is blanked, the SysTick tasks are
+ * stopped and the CPU waits in deep sleep until the accelerometer raises activity or
+ * a button changes. Step counts and the UI are left as they were and carry on when
+ * woken. The time in each state is kept by a wide timer clocked from the PIOSC,
+ * which keeps counting in deep sleep.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#include "buttons4.h"
+
+#include "power.h"
+#include "accelerometer.h"
+#include "display.h"
+
+/* The wide timer counts down from its load value at the PIOSC frequency. */
+#define POWER_CLOCK_HZ 16000000
+#define POWER_CLOCK_LOAD UINT64_MAX
+
+/* The buttons, in the order of butNames, wake the CPU on either edge. */
+static const uint32_t button_ports[NUM_BUTS] = { UP_BUT_PORT_BASE, DOWN_BUT_PORT_BASE,
+		LEFT_BUT_PORT_BASE, RIGHT_BUT_PORT_BASE };
+static const uint8_t button_pins[NUM_BUTS] = { UP_BUT_PIN, DOWN_BUT_PIN, LEFT_BUT_PIN,
+		RIGHT_BUT_PIN };
+
+static power_state state;
+
+/* Clock ticks spent in each state, up to state_since for the current state. */
+static uint64_t state_ticks[POWER_STATE_COUNT];
+static uint64_t state_since;
+
+/* Clock at which the wearer went still or a button was last used. */
+static uint64_t quiet_since;
+static uint16_t sleep_timeout_s;
+
+/* Set by the button interrupts while asleep. */
+static volatile bool button_woken;
+
+/* Returns the clock ticks since init_power. */
+static uint64_t power_clock(void) {
+	return POWER_CLOCK_LOAD - TimerValueGet64(WTIMER0_BASE);
+}
+
+/* Adds the time since the last change to the current state and moves to the new state. */
+static void set_power_state(power_state next, uint64_t now) {
+	state_ticks[state] += now - state_since;
+	state_since = now;
+	state = next;
+}
+
+/* Records that a button woke the CPU. The buttons are spread over three ports,
+ * which all share this handler. */
+static void button_wake_handler(void) {
+	uint8_t i;
+	for (i = 0; i < NUM_BUTS; i++) {
+		GPIOIntClear(button_ports[i], button_pins[i]);
+	}
+	button_woken = true;
+}
+
+/* Turns the button interrupts on for sleeping, or off again once woken. */
+static void set_button_wake(bool enabled) {
+	uint8_t i;
+	for (i = 0; i < NUM_BUTS; i++) {
+		if (enabled) {
+			GPIOIntClear(button_ports[i], button_pins[i]);
+			GPIOIntEnable(button_ports[i], button_pins[i]);
+		} else {
+			GPIOIntDisable(button_ports[i], button_pins[i]);
+		}
+	}
+}
+
+/* Returns true if the accelerometer or a button has given the CPU something to do.
+ * The main loop may have already handled the event that woke it, leaving the
+ * accelerometer no longer idle. */
+static bool wake_pending(void) {
+	return button_woken || accl_event_waiting() || !accl_idle();
+}
+
+/* Blanks the display and stops the tasks. The accelerometer interrupt is left on. */
+static void enter_sleep(uint64_t now) {
+	display_blank();
+	SysTickIntDisable();
+	button_woken = false;
+	set_button_wake(true);
+	set_power_state(POWER_SLEEP, now);
+}
+
+/* Restarts the tasks and draws the display as it was. The main loop then handles
+ * the accelerometer event that woke the CPU, if any. */
+static void leave_sleep(uint64_t now) {
+	set_button_wake(false);
+	SysTickIntEnable();
+	display_unblank();
+	quiet_since = now;
+	set_power_state(POWER_IDLE, now);
+}
+
+/* Starts the power state clock and sets up the button interrupts that wake the CPU. */
+void init_power(void) {
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_WTIMER0);
+	TimerClockSourceSet(WTIMER0_BASE, TIMER_CLOCK_PIOSC);
+	TimerConfigure(WTIMER0_BASE, TIMER_CFG_PERIODIC);
+	TimerLoadSet64(WTIMER0_BASE, POWER_CLOCK_LOAD);
+	TimerEnable(WTIMER0_BASE, TIMER_A);
+
+	/* Only the clock and the GPIO ports of the accelerometer interrupt and the
+	 * buttons are kept running in deep sleep, all from the PIOSC. */
+	SysCtlPeripheralDeepSleepEnable(SYSCTL_PERIPH_WTIMER0);
+	SysCtlPeripheralDeepSleepEnable(SYSCTL_PERIPH_GPIOB);
+	SysCtlPeripheralDeepSleepEnable(SYSCTL_PERIPH_GPIOD);
+	SysCtlPeripheralDeepSleepEnable(SYSCTL_PERIPH_GPIOE);
+	SysCtlPeripheralDeepSleepEnable(SYSCTL_PERIPH_GPIOF);
+	SysCtlPeripheralClockGating(true);
+	SysCtlDeepSleepClockSet(SYSCTL_DSLP_DIV_1 | SYSCTL_DSLP_OSC_INT);
+
+	uint8_t i;
+	for (i = 0; i < NUM_BUTS; i++) {
+		GPIOIntRegister(button_ports[i], button_wake_handler);
+		GPIOIntTypeSet(button_ports[i], button_pins[i], GPIO_BOTH_EDGES);
+	}
+	set_button_wake(false);
+	button_woken = false;
+
+	for (i = 0; i < POWER_STATE_COUNT; i++) {
+		state_ticks[i] = 0;
+	}
+	state = POWER_ACTIVE;
+	state_since = power_clock();
+	quiet_since = state_since;
+	sleep_timeout_s = POWER_DEFAULT_SLEEP_TIMEOUT_S;
+}
+
+/* Sets how long the wearer must stay still before the monitor goes to sleep. */
+void set_sleep_timeout(uint16_t seconds) {
+	sleep_timeout_s = seconds;
+}
+
+/* Restarts the sleep timeout, called when a button is used. */
+void power_user_activity(void) {
+	quiet_since = power_clock();
+}
+
+/* Moves between the power states, sleeping while there is nothing to do. */
+power_state update_power(void) {
+	if (state == POWER_SLEEP) {
+		/* Interrupts are masked from the check until the CPU sleeps, so an event
+		 * raised in between is left pending and wakes it straight away. */
+		IntMasterDisable();
+		if (!wake_pending()) {
+			SysCtlDeepSleep();
+		}
+		IntMasterEnable();
+		if (!wake_pending()) {
+			return state;
+		}
+		leave_sleep(power_clock());
+	}
+
+	uint64_t now = power_clock();
+	power_state awake = accl_idle() ? POWER_IDLE : POWER_ACTIVE;
+	if (awake != state) {
+		set_power_state(awake, now);
+		quiet_since = now;
+	}
+	if (state == POWER_IDLE && now - quiet_since >= (uint64_t) sleep_timeout_s * POWER_CLOCK_HZ) {
+		enter_sleep(now);
+	}
+	return state;
+}
+
+/* Returns the current power state. */
+power_state get_power_state(void) {
+	return state;
+}
+
+/* Returns the time spent in a power state since init_power in milliseconds. */
+uint64_t get_power_state_ms(power_state which) {
+	uint64_t ticks = state_ticks[which];
+	if (which == state) {
+		ticks += power_clock() - state_since;
+	}
+	return ticks / (POWER_CLOCK_HZ / 1000);
+}
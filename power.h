@@ -0,0 +1,52 @@
+/*
+ * File: power.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Module for putting the fitness monitor into deep sleep while the wearer is still,
+ * and keeping track of the time spent in each power state.
+ *
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Default time the wearer must stay still, once the accelerometer reports
+ * inactivity, before the monitor goes to sleep. */
+#define POWER_DEFAULT_SLEEP_TIMEOUT_S 30
+
+typedef enum {
+	POWER_ACTIVE,   /* Sampling for steps. */
+	POWER_IDLE,     /* The accelerometer reports the wearer still, the display is on. */
+	POWER_SLEEP,    /* Display blanked, tasks stopped and the CPU in deep sleep. */
+	POWER_STATE_COUNT
+} power_state;
+
+/* Starts the power state clock and sets up the button interrupts that wake the CPU.
+ * Must be called after the accelerometer and buttons have been initialized. */
+void init_power(void);
+
+/* Sets how long the wearer must stay still before the monitor goes to sleep. */
+void set_sleep_timeout(uint16_t seconds);
+
+/* Restarts the sleep timeout, called when a button is used. */
+void power_user_activity(void);
+
+/* Moves between the power states, called every pass of the main loop after the
+ * accelerometer events have been handled. While asleep this waits in deep sleep
+ * until the accelerometer raises an event or a button changes, and returns
+ * POWER_SLEEP while there is still nothing to do. */
+power_state update_power(void);
+
+/* Returns the current power state. */
+power_state get_power_state(void);
+
+/* Returns the time spent in a power state since init_power in milliseconds. */
+uint64_t get_power_state_ms(power_state state);
+
+#endif /* POWER_H */
@@ -0,0 +1,46 @@
+/*
+ * File: running_stats.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Exponentially weighted running mean and variance in fixed point. Each update
+ * is a few adds and shifts, so statistics of a signal can be kept per sample
+ * without storing a window of past values.
+ */
+
+#include <stdint.h>
+
+#include "running_stats.h"
+
+/* Initializes the statistics to a known mean with no variance. */
+void init_running_stats(running_stats_t *stats, uint8_t shift, int32_t initial_mean) {
+	stats->mean = initial_mean * (1 << RUNNING_STATS_FRAC_BITS);
+	stats->variance = 0;
+	stats->shift = shift;
+}
+
+/* Adds a value to the running statistics.
+ * This is the exponentially weighted form of Welford's update:
+ *   mean += (value - mean) / 2^shift
+ *   variance += ((value - old mean) * (value - new mean) - variance) / 2^shift
+ * Inputs are expected to stay within +-2^14 so the products fit in 32 bits. */
+void update_running_stats(running_stats_t *stats, int32_t value) {
+	int32_t scaled = value * (1 << RUNNING_STATS_FRAC_BITS);
+	int32_t old_deviation = (scaled - stats->mean) >> RUNNING_STATS_FRAC_BITS;
+	stats->mean += (scaled - stats->mean) >> stats->shift;
+	int32_t new_deviation = (scaled - stats->mean) >> RUNNING_STATS_FRAC_BITS;
+	int32_t spread = old_deviation * new_deviation;
+	stats->variance += (spread - (int32_t) stats->variance) >> stats->shift;
+}
+
+/* Returns the running mean, rounded down. */
+int32_t running_stats_mean(const running_stats_t *stats) {
+	return stats->mean >> RUNNING_STATS_FRAC_BITS;
+}
+
+/* Returns the running variance in squared input units. */
+uint32_t running_stats_variance(const running_stats_t *stats) {
+	return stats->variance;
+}
@@ -0,0 +1,38 @@
+/*
+ * File: running_stats.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Exponentially weighted running mean and variance in fixed point. Each update
+ * is a few adds and shifts, so statistics of a signal can be kept per sample
+ * without storing a window of past values.
+ */
+
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+/* Fractional bits kept in the mean so small changes are not lost to rounding. */
+#define RUNNING_STATS_FRAC_BITS 8
+
+typedef struct {
+	int32_t mean;      /* Mean scaled by 2^RUNNING_STATS_FRAC_BITS. */
+	uint32_t variance; /* Variance in squared input units. */
+	uint8_t shift;     /* The statistics follow roughly the last 2^shift values. */
+} running_stats_t;
+
+/* Initializes the statistics to a known mean with no variance.
+ * The statistics follow roughly the last 2^shift values. */
+void init_running_stats(running_stats_t *stats, uint8_t shift, int32_t initial_mean);
+
+/* Adds a value to the running statistics. */
+void update_running_stats(running_stats_t *stats, int32_t value);
+
+/* Returns the running mean, rounded down. */
+int32_t running_stats_mean(const running_stats_t *stats);
+
+/* Returns the running variance in squared input units. */
+uint32_t running_stats_variance(const running_stats_t *stats);
+
+#endif /* RUNNING_STATS_H */
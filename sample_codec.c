@@ -0,0 +1,223 @@
+/*
+ * File: sample_codec.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Lossless compression of blocks of accelerometer readings by prediction,
+ * zigzag coding and bit packing.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sample_codec.h"
+
+/* Readings in each lane of a block. */
+#define LANE_READINGS (SAMPLE_CODEC_BLOCK / SAMPLE_CODEC_LANES)
+
+/* Maps residuals 0, -1, 1, -2, 2 ... to codes 0, 1, 2, 3, 4 ... */
+static uint16_t zigzag(uint16_t residual) {
+	return (uint16_t) (residual << 1) ^ (uint16_t) -(residual >> 15);
+}
+
+static uint16_t unzigzag(uint16_t code) {
+	return (code >> 1) ^ (uint16_t) -(code & 1);
+}
+
+/* Returns the residual of reading i of a block against its prediction. The change
+ * into the block is taken as zero for the linear prediction. */
+static uint16_t residual(const int16_t *readings, int16_t previous, uint16_t i,
+		uint8_t prediction) {
+	uint16_t last = i >= 1 ? readings[i - 1] : previous;
+	uint16_t before = i >= 2 ? readings[i - 2] : previous;
+	uint16_t predicted = prediction == SAMPLE_CODEC_LINEAR ? 2 * last - before : last;
+	return (uint16_t) readings[i] - predicted;
+}
+
+/* Returns the number of bits below the highest set bit of codes. */
+static uint8_t bits_needed(uint16_t codes) {
+	uint8_t bits = 0;
+	while (codes >> bits) {
+		bits++;
+	}
+	return bits;
+}
+
+static void write_word(uint8_t *words, uint16_t index, uint16_t word) {
+	words[2 * index] = word & 0xFF;
+	words[2 * index + 1] = word >> 8;
+}
+
+static uint16_t read_word(const uint8_t *words, uint16_t index) {
+	return words[2 * index] | words[2 * index + 1] << 8;
+}
+
+/* Packs a block of readings. The first pass finds the bits each prediction needs
+ * from the or of its codes, the second packs the codes of the better one, lane by
+ * lane. */
+uint16_t encode_sample_block(const int16_t *readings, int16_t previous, uint8_t *out) {
+	uint16_t last = previous;
+	uint16_t change = 0;
+	uint16_t previous_codes = 0;
+	uint16_t linear_codes = 0;
+	uint16_t i;
+	for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+		uint16_t next_change = (uint16_t) readings[i] - last;
+		previous_codes |= zigzag(next_change);
+		linear_codes |= zigzag(next_change - change);
+		change = next_change;
+		last = readings[i];
+	}
+	uint8_t prediction = SAMPLE_CODEC_PREVIOUS;
+	uint8_t bits = bits_needed(previous_codes);
+	if (bits_needed(linear_codes) < bits) {
+		prediction = SAMPLE_CODEC_LINEAR;
+		bits = bits_needed(linear_codes);
+	}
+	out[0] = bits;
+	out[1] = prediction;
+	write_word(out, 1, previous);
+
+	uint8_t *words = out + SAMPLE_CODEC_HEADER;
+	uint16_t lane;
+	for (lane = 0; bits && lane < SAMPLE_CODEC_LANES; lane++) {
+		/* Codes are added above the bits held and written out 16 bits at a time. */
+		uint32_t held_bits = 0;
+		uint8_t held = 0;
+		uint16_t word = 0;
+		uint16_t k;
+		for (k = 0; k < LANE_READINGS; k++) {
+			uint16_t code = zigzag(residual(readings, previous, k * SAMPLE_CODEC_LANES + lane,
+					prediction));
+			held_bits |= (uint32_t) code << held;
+			held += bits;
+			if (held >= 16) {
+				write_word(words, word * SAMPLE_CODEC_LANES + lane, held_bits);
+				word++;
+				held_bits >>= 16;
+				held -= 16;
+			}
+		}
+	}
+	return SAMPLE_CODEC_HEADER + bits * SAMPLE_CODEC_LANES * 2;
+}
+
+/* Returns the number of bytes of a packed block. */
+uint16_t sample_block_size(const uint8_t *packed) {
+	if (packed[0] > 16
+			|| (packed[1] != SAMPLE_CODEC_PREVIOUS && packed[1] != SAMPLE_CODEC_LINEAR)) {
+		return 0;
+	}
+	return SAMPLE_CODEC_HEADER + packed[0] * SAMPLE_CODEC_LANES * 2;
+}
+
+/* Unpacks a block, the residuals of each lane first then the readings from them
+ * in order. */
+uint16_t decode_sample_block_c(const uint8_t *packed, int16_t *readings) {
+	uint16_t size = sample_block_size(packed);
+	if (size == 0) {
+		return 0;
+	}
+	uint8_t bits = packed[0];
+	const uint8_t *words = packed + SAMPLE_CODEC_HEADER;
+	uint32_t mask = (1u << bits) - 1;
+	uint16_t lane;
+	for (lane = 0; lane < SAMPLE_CODEC_LANES; lane++) {
+		uint32_t held_bits = 0;
+		uint8_t held = 0;
+		uint16_t word = 0;
+		uint16_t k;
+		for (k = 0; k < LANE_READINGS; k++) {
+			if (held < bits) {
+				held_bits |= (uint32_t) read_word(words, word * SAMPLE_CODEC_LANES + lane) << held;
+				word++;
+				held += 16;
+			}
+			readings[k * SAMPLE_CODEC_LANES + lane] = unzigzag(held_bits & mask);
+			held_bits >>= bits;
+			held -= bits;
+		}
+	}
+
+	uint16_t last = read_word(packed, 1);
+	uint16_t change = 0;
+	uint16_t i;
+	if (packed[1] == SAMPLE_CODEC_LINEAR) {
+		for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+			change += readings[i];
+			last += change;
+			readings[i] = last;
+		}
+	} else {
+		for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+			last += readings[i];
+			readings[i] = last;
+		}
+	}
+	return size;
+}
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+/* Sums each lane with those before it, plus carry, which holds the total before
+ * the 16 lanes in every lane. Returns the sums, and sets carry to the last. */
+static __m256i prefix_sum_avx2(__m256i v, __m256i *carry) {
+	v = _mm256_add_epi16(v, _mm256_slli_si256(v, 2));
+	v = _mm256_add_epi16(v, _mm256_slli_si256(v, 4));
+	v = _mm256_add_epi16(v, _mm256_slli_si256(v, 8));
+	/* Each 128 bit half is summed, the low half's total goes into the high half. */
+	__m256i totals = _mm256_unpackhi_epi64(_mm256_shufflehi_epi16(v, 0xFF),
+			_mm256_shufflehi_epi16(v, 0xFF));
+	v = _mm256_add_epi16(v, _mm256_permute2x128_si256(totals, totals, 0x08));
+	v = _mm256_add_epi16(v, *carry);
+	totals = _mm256_unpackhi_epi64(_mm256_shufflehi_epi16(v, 0xFF),
+			_mm256_shufflehi_epi16(v, 0xFF));
+	*carry = _mm256_permute4x64_epi64(totals, 0xFF);
+	return v;
+}
+
+/* Unpacks a block 16 readings at a time. Word j of every lane is one vector, and
+ * each reading of the lanes is shifted out of the one or two words holding it. */
+uint16_t decode_sample_block_avx2(const uint8_t *packed, int16_t *readings) {
+	uint16_t size = sample_block_size(packed);
+	if (size == 0) {
+		return 0;
+	}
+	uint8_t bits = packed[0];
+	const __m256i *words = (const __m256i *) (packed + SAMPLE_CODEC_HEADER);
+	__m256i mask = _mm256_set1_epi16((int16_t) ((1u << bits) - 1));
+	__m256i one = _mm256_set1_epi16(1);
+	__m256i zero = _mm256_setzero_si256();
+	__m256i last = _mm256_set1_epi16((int16_t) read_word(packed, 1));
+	__m256i change = zero;
+	bool linear = packed[1] == SAMPLE_CODEC_LINEAR;
+	uint16_t offset = 0;
+	uint16_t k;
+	for (k = 0; k < LANE_READINGS; k++) {
+		__m256i codes = zero;
+		if (bits) {
+			uint16_t shift = offset & 15;
+			codes = _mm256_srl_epi16(_mm256_loadu_si256(words + (offset >> 4)),
+					_mm_cvtsi32_si128(shift));
+			if (shift + bits > 16) {
+				codes = _mm256_or_si256(codes, _mm256_sll_epi16(
+						_mm256_loadu_si256(words + (offset >> 4) + 1),
+						_mm_cvtsi32_si128(16 - shift)));
+			}
+			codes = _mm256_and_si256(codes, mask);
+			offset += bits;
+		}
+		__m256i v = _mm256_xor_si256(_mm256_srli_epi16(codes, 1),
+				_mm256_sub_epi16(zero, _mm256_and_si256(codes, one)));
+		if (linear) {
+			v = prefix_sum_avx2(v, &change);
+		}
+		v = prefix_sum_avx2(v, &last);
+		_mm256_storeu_si256((__m256i *) (readings + k * SAMPLE_CODEC_LANES), v);
+	}
+	return size;
+}
+#endif
@@ -0,0 +1,71 @@
+/*
+ * File: sample_codec.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Lossless compression of blocks of accelerometer readings for storing traces.
+ * Each reading of a block is predicted from the two before it, either as the
+ * previous reading or by extending the line through both, whichever leaves the
+ * smaller residuals over the block. The residuals are zigzag coded so small
+ * negative ones are small too, and packed at the fewest bits that hold the
+ * largest of them.
+ *
+ * Encoding takes two passes over the block with a handful of integer operations
+ * per reading and no buffer, cheap enough for the TM4C123 to compress its
+ * readings as it takes them. The packing is laid out for decoding 16 readings at
+ * once: reading i of the block goes to lane i % 16, and the bits of each lane
+ * run through every 16th 16 bit word. Host builds with AVX2 decode a block with
+ * one vector per word of the lanes.
+ *
+ * A packed block is a SAMPLE_CODEC_HEADER byte header, then the packed words:
+ *   0  uint8 bits per residual, 0 to 16
+ *   1  uint8 prediction, SAMPLE_CODEC_PREVIOUS or SAMPLE_CODEC_LINEAR
+ *   2  int16 the reading before the block, from which it is predicted
+ *   4  bits * SAMPLE_CODEC_LANES little endian uint16 words
+ * Residuals wrap at 16 bits, so any int16 readings round trip.
+ */
+
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdint.h>
+
+/* Readings in a block, and the readings decoded at once. */
+#define SAMPLE_CODEC_BLOCK 256
+#define SAMPLE_CODEC_LANES 16
+
+#define SAMPLE_CODEC_HEADER 4
+
+/* The most bytes a block packs into, at 16 bits per reading. */
+#define SAMPLE_CODEC_MAX_BYTES (SAMPLE_CODEC_HEADER + SAMPLE_CODEC_BLOCK * 2)
+
+/* Predictions of each reading: the one before, or the one before plus the change
+ * into it. */
+#define SAMPLE_CODEC_PREVIOUS 1
+#define SAMPLE_CODEC_LINEAR 2
+
+/* Packs SAMPLE_CODEC_BLOCK readings, predicted from previous, the reading before
+ * the block, into out, which must hold SAMPLE_CODEC_MAX_BYTES. Passing the last
+ * reading of one block to the next keeps a stream of blocks predicted throughout.
+ * Returns the number of bytes written. */
+uint16_t encode_sample_block(const int16_t *readings, int16_t previous, uint8_t *out);
+
+/* Returns the number of bytes of a packed block from its header, or 0 if the
+ * header is not valid. */
+uint16_t sample_block_size(const uint8_t *packed);
+
+/* Unpacks a block into SAMPLE_CODEC_BLOCK readings. Returns the number of bytes
+ * read, or 0 without writing any readings if the header is not valid. */
+uint16_t decode_sample_block_c(const uint8_t *packed, int16_t *readings);
+
+#if defined(__AVX2__)
+/* The same, 16 readings at a time. */
+uint16_t decode_sample_block_avx2(const uint8_t *packed, int16_t *readings);
+#define decode_sample_block decode_sample_block_avx2
+#else
+#define decode_sample_block decode_sample_block_c
+#endif
+
+#endif /* SAMPLE_CODEC_H */
@@ -0,0 +1,324 @@
+/*
+ * File: step_detector.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Step detection from raw accelerometer samples, packaged as an object so any
+ * number of detectors can run side by side.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "accelerometer.h"
+#include "units.h"
+#include "step_detector.h"
+
+/* The vertical acceleration is band pass filtered to the frequencies of walking and
+ * running, ~0.5Hz to 5Hz. The high pass removes gravity, the low pass removes
+ * sensor noise and the sharp edge of heel strikes. */
+#define STEP_BAND_LOW_HZ 0.5
+#define STEP_BAND_HIGH_HZ 5.0
+
+struct step_rate {
+	uint16_t rate_hz;
+	biquad_coefs_t highpass;
+	biquad_coefs_t lowpass;
+	int32_t gait_coefs[GAIT_GATE_BINS];
+	uint8_t stats_shift;              /* The running statistics follow ~2.5 seconds. */
+	uint8_t gravity_shift;            /* Gravity follows ~5 seconds. Faster averages lean
+	                                   * with the side to side sway of each stride, which
+	                                   * then leaks into the projection. */
+};
+
+#define STEP_RATE(fs, stats_shift, gravity_shift) { fs, \
+	BIQUAD_HIGHPASS(STEP_BAND_LOW_HZ, fs), BIQUAD_LOWPASS(STEP_BAND_HIGH_HZ, fs), \
+	GAIT_GATE_COEFS(fs), stats_shift, gravity_shift }
+
+/* Every coefficient is worked out at compile time, and shared by all detectors. */
+static const step_rate_t step_rates[] = {
+	STEP_RATE(25, 6, 7),
+	STEP_RATE(50, 7, 8),
+	STEP_RATE(100, 8, 9)
+};
+
+#define STEP_RATE_COUNT (sizeof(step_rates) / sizeof(step_rates[0]))
+
+/* Step intervals range from 0.25s, a 240 steps per minute sprint, to 2s. A longer
+ * gap means the wearer has stopped and the cadence is measured again. */
+#define MIN_STEP_INTERVAL(fs) ((fs) / 4)
+#define MAX_STEP_INTERVAL(fs) ((fs) * 2)
+
+/* Steps are detected by a cascade, each stage only running on what the one
+ * before passes. The motion gate checks each sample for any motion, blocks with
+ * motion are checked by the gait gate for power at gait frequencies, and only
+ * while that is open does the step detector run. */
+
+/* 1g of vertical acceleration, in full resolution units with GRAVITY_FRAC_BITS. */
+#define VERTICAL_PER_G (ACCL_FULL_RES_LSB_PER_G << GRAVITY_FRAC_BITS)
+
+/* A deviation of the vertical acceleration beyond 1/32g, ~0.03g, is motion. Noise on
+ * a still device peaks at about 1/64g. This matches the smallest swing the gait gate
+ * accepts, so the motion gate does not reject blocks the gait gate would open on. */
+#define MOTION_THRESHOLD (VERTICAL_PER_G / 32)
+
+/* Samples split into x, y and z at a time by push_step_samples. */
+#define STEP_SAMPLES_CHUNK 16
+
+/* Returns the coefficients for a sample rate, or 0 if there are none. */
+static const step_rate_t *find_step_rate(uint16_t rate_hz) {
+	uint8_t i;
+	for (i = 0; i < STEP_RATE_COUNT; i++) {
+		if (step_rates[i].rate_hz == rate_hz) {
+			return &step_rates[i];
+		}
+	}
+	return 0;
+}
+
+/* Starts the peak picking and cadence afresh, as if the wearer had been still. */
+static void reset_step_stages(step_detector_t *detector) {
+	const step_rate_t *rate = detector->rate;
+	init_running_stats(&detector->stats, rate->stats_shift, 0);
+	init_peak_detector(&detector->peaks, MIN_STEP_INTERVAL(rate->rate_hz),
+			MAX_STEP_INTERVAL(rate->rate_hz));
+	init_cadence(&detector->cadence, rate->rate_hz / CADENCE_RATE_HZ);
+
+	/* The filters are settled on the first acceleration measured, so there is no
+	 * start up transient to be mistaken for a step. */
+	detector->filter_primed = false;
+}
+
+/* Returns true if the detector has coefficients for the sample rate. */
+bool step_detector_supports_rate(uint16_t rate_hz) {
+	return find_step_rate(rate_hz) != 0;
+}
+
+/* Initializes a detector for samples at rate_hz with no steps counted. */
+bool init_step_detector(step_detector_t *detector, uint16_t rate_hz, vector3_t rest) {
+	const step_rate_t *rate = find_step_rate(rate_hz);
+	if (rate == 0) {
+		return false;
+	}
+	detector->rate = rate;
+	detector->steps = 0;
+	detector->samples = 0;
+	detector->fixed_threshold = 0;
+	detector->gate_stats.blocks = 0;
+	detector->gate_stats.open_blocks = 0;
+	detector->gate_stats.rejected_blocks = 0;
+	detector->gate_stats.detected = 0;
+	seed_step_detector(detector, rest);
+	return true;
+}
+
+/* Switches to a new sample rate, carrying on from the current estimate of gravity. */
+bool set_step_detector_rate(step_detector_t *detector, uint16_t rate_hz) {
+	const step_rate_t *rate = find_step_rate(rate_hz);
+	if (rate == 0) {
+		return false;
+	}
+	detector->rate = rate;
+	seed_step_detector(detector, gravity_average(&detector->gravity));
+	return true;
+}
+
+/* Starts gravity, the gates and the step stages from a reading taken at rest,
+ * so detection is settled from the first sample. */
+void seed_step_detector(step_detector_t *detector, vector3_t rest) {
+	const step_rate_t *rate = detector->rate;
+	init_gravity(&detector->gravity, rest, rate->gravity_shift);
+	int32_t rest_vertical = update_gravity(&detector->gravity, rest);
+
+	reset_step_stages(detector);
+	init_biquad(&detector->highpass, &rate->highpass, rest_vertical, 0);
+	init_biquad(&detector->lowpass, &rate->lowpass, 0, 0);
+	detector->filter_primed = true;
+
+	detector->block_length = GAIT_GATE_BLOCK(rate->rate_hz);
+	init_motion_gate(&detector->motion_gate, rest_vertical, MOTION_THRESHOLD,
+			detector->block_length);
+	init_gait_gate(&detector->gait_gate, rate->gait_coefs, detector->block_length);
+	detector->block_count = 0;
+	detector->block_motion = false;
+}
+
+/* Fixes the step threshold, or adapts it again if the threshold is 0. */
+void set_step_threshold(step_detector_t *detector, int32_t threshold) {
+	detector->fixed_threshold = threshold;
+}
+
+/* Runs the step stages on one sample of vertical acceleration, the given sample
+ * since init_step_detector. Returns the number of steps confirmed, writing their
+ * peaks as push_step_block. */
+static uint16_t detect_step_vertical(step_detector_t *detector, int32_t vertical,
+		uint32_t sample, uint32_t *peaks, uint16_t max_peaks) {
+	const step_rate_t *rate = detector->rate;
+
+	/* Band pass filtering gets rid of the effect of gravity. */
+	if (!detector->filter_primed) {
+		init_biquad(&detector->highpass, &rate->highpass, vertical, 0);
+		init_biquad(&detector->lowpass, &rate->lowpass, 0, 0);
+		detector->filter_primed = true;
+	}
+	int32_t mag_acc_final = update_biquad(&detector->lowpass,
+			update_biquad(&detector->highpass, vertical)) >> GRAVITY_FRAC_BITS;
+
+	/* The threshold adapts to how strongly the wearer is moving. It sits a fraction of
+	 * a standard deviation above the running mean, so light walkers still cross it
+	 * while noisy surroundings raise it. Comparing squares avoids a square root. */
+	int32_t deviation = mag_acc_final - running_stats_mean(&detector->stats);
+	uint32_t variance = running_stats_variance(&detector->stats);
+	update_running_stats(&detector->stats, mag_acc_final);
+	bool above_threshold = deviation > MIN_STEP_THRESHOLD
+			&& ((uint32_t) (deviation * deviation) << (2 * STEP_THRESHOLD_DEVIATION_SHIFT)) > variance;
+	if (detector->fixed_threshold != 0) {
+		above_threshold = mag_acc_final > detector->fixed_threshold;
+	}
+
+	/* Each step is the highest point of its swing above the threshold. Bounces
+	 * within a step are skipped by the refractory period that follows the cadence. */
+	bool step = update_peak_detector(&detector->peaks, mag_acc_final, above_threshold);
+
+	/* Steps only count once the acceleration is found to repeat, so one off knocks do
+	 * not. The peak was the sample before. */
+	update_cadence(&detector->cadence, mag_acc_final, step, sample - 1);
+
+	/* The period of the repetition is the period of every step, even if the peak
+	 * detector has locked onto every other one after a jump in cadence. */
+	uint16_t period = cadence_period(&detector->cadence);
+	if (period != 0) {
+		limit_peak_interval(&detector->peaks, period * (rate->rate_hz / CADENCE_RATE_HZ));
+	}
+	return cadence_take_steps(&detector->cadence, peaks, max_peaks);
+}
+
+/* Runs the step stages on count samples of vertical acceleration from the given
+ * sample on, after steps already found in the block. Returns the new number of
+ * steps found, writing the peaks of the new ones after the others while there is
+ * room. */
+static uint16_t detect_steps_vertical(step_detector_t *detector, const int32_t *vertical,
+		uint16_t count, uint32_t sample, uint16_t steps, uint32_t *peaks, uint16_t max_peaks) {
+	uint16_t i;
+	for (i = 0; i < count; i++) {
+		uint16_t room = steps < max_peaks ? max_peaks - steps : 0;
+		steps += detect_step_vertical(detector, vertical[i], sample + i,
+				room ? peaks + steps : 0, room);
+	}
+	return steps;
+}
+
+/* Detects steps in a block of samples. The block is split where gate blocks end,
+ * and each part is passed down the cascade a stage at a time, only as far as needed. */
+uint16_t push_step_block(step_detector_t *detector, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint16_t count, uint32_t *peaks, uint16_t max_peaks) {
+	uint16_t steps = 0;
+	uint16_t done = 0;
+	while (done < count) {
+		uint16_t n = detector->block_length - detector->block_count;
+		if (n > count - done) {
+			n = count - done;
+		}
+		/* The vertical acceleration goes straight into the gate block. */
+		int32_t *vertical = &detector->block[detector->block_count];
+		update_gravity_block(&detector->gravity, x + done, y + done, z + done, n, vertical);
+		detector->block_motion |= update_motion_gate_block(&detector->motion_gate, vertical, n);
+		detector->block_count += n;
+
+		/* The gate only changes at the end of a gate block. */
+		bool was_open = gait_gate_open(&detector->gait_gate);
+		if (was_open) {
+			steps = detect_steps_vertical(detector, vertical, n, detector->samples, steps,
+					peaks, max_peaks);
+			detector->gate_stats.detected += n;
+		}
+		detector->samples += n;
+		done += n;
+		if (detector->block_count < detector->block_length) {
+			continue;
+		}
+
+		if (detector->block_motion) {
+			update_gait_gate(&detector->gait_gate, detector->block);
+		} else {
+			skip_gait_gate(&detector->gait_gate);
+		}
+		detector->gate_stats.blocks++;
+		if (gait_gate_open(&detector->gait_gate)) {
+			detector->gate_stats.open_blocks++;
+		} else if (detector->block_motion) {
+			detector->gate_stats.rejected_blocks++;
+		}
+		detector->block_count = 0;
+		detector->block_motion = false;
+		if (!was_open && gait_gate_open(&detector->gait_gate)) {
+			/* Catch up on the block that opened the gate with the step stages started
+			 * afresh, as the filters were not run while the gate was closed. The block
+			 * ends with the last sample pushed. */
+			reset_step_stages(detector);
+			steps = detect_steps_vertical(detector, detector->block, detector->block_length,
+					detector->samples - detector->block_length, steps, peaks, max_peaks);
+			detector->gate_stats.detected += detector->block_length;
+		}
+	}
+	detector->steps += steps;
+	return steps;
+}
+
+/* Detects steps in consecutive samples, returning the number confirmed. The
+ * samples are split into x, y and z a few at a time for push_step_block. */
+uint16_t push_step_samples(step_detector_t *detector, const vector3_t *samples, uint16_t count) {
+	int16_t x[STEP_SAMPLES_CHUNK];
+	int16_t y[STEP_SAMPLES_CHUNK];
+	int16_t z[STEP_SAMPLES_CHUNK];
+	uint16_t steps = 0;
+	while (count > 0) {
+		uint16_t n = count < STEP_SAMPLES_CHUNK ? count : STEP_SAMPLES_CHUNK;
+		uint16_t i;
+		for (i = 0; i < n; i++) {
+			x[i] = samples[i].x;
+			y[i] = samples[i].y;
+			z[i] = samples[i].z;
+		}
+		steps += push_step_block(detector, x, y, z, n, 0, 0);
+		samples += n;
+		count -= n;
+	}
+	return steps;
+}
+
+/* Returns the steps confirmed since init_step_detector. */
+uint32_t step_detector_count(const step_detector_t *detector) {
+	return detector->steps;
+}
+
+/* Returns the samples pushed since init_step_detector. */
+uint32_t step_detector_samples(const step_detector_t *detector) {
+	return detector->samples;
+}
+
+/* Returns how much the gates have let through since init_step_detector. */
+step_gate_stats_t step_detector_gate_stats(const step_detector_t *detector) {
+	return detector->gate_stats;
+}
+
+/* Returns the cadence in steps per minute, 0 if not walking or running. */
+uint16_t step_detector_cadence(const step_detector_t *detector) {
+	if (!gait_gate_open(&detector->gait_gate)) {
+		return 0;
+	}
+	return cadence_steps_per_minute(&detector->cadence);
+}
+
+/* Returns the sample rate in Hz. */
+uint16_t step_detector_rate(const step_detector_t *detector) {
+	return detector->rate->rate_hz;
+}
+
+/* Returns the current estimate of gravity in raw units. */
+vector3_t step_detector_gravity(const step_detector_t *detector) {
+	return gravity_average(&detector->gravity);
+}
@@ -0,0 +1,153 @@
+/*
+ * File: step_detector.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Step detection from raw accelerometer samples, packaged as an object so any
+ * number of detectors can run side by side. All state is kept in the
+ * step_detector_t, and nothing here touches the hardware, so the same code counts
+ * steps on the device and in host tools. Requires accelerometer.h to be included
+ * first.
+ */
+
+#ifndef STEP_DETECTOR_H
+#define STEP_DETECTOR_H
+
+#include "biquad.h"
+#include "running_stats.h"
+#include "peak_detector.h"
+#include "cadence.h"
+#include "gait_gate.h"
+#include "motion_gate.h"
+#include "gravity.h"
+
+/* Highest sample rate the detector has coefficients for, sizes the gate block. */
+#define STEP_DETECTOR_MAX_RATE_HZ 100
+
+/* The step threshold never drops below this, so sensor noise and small movements
+ * while still are not counted. 12 raw units is ~0.05g. */
+#define MIN_STEP_THRESHOLD (ACCL_FULL_RES_LSB_PER_G * 3 / 64)
+
+/* A sample is above the threshold when it is more than 1 / 2^STEP_THRESHOLD_DEVIATION_SHIFT
+ * standard deviations above the running mean, half a standard deviation by default. */
+#define STEP_THRESHOLD_DEVIATION_SHIFT 1
+
+/* Everything in the step detector that depends on the sample rate. */
+typedef struct step_rate step_rate_t;
+
+/* How much of the input the gates let through to the step stages, for tools that
+ * measure what the gates save. */
+typedef struct {
+	uint32_t blocks;           /* Gate blocks ended. */
+	uint32_t open_blocks;      /* Of those, blocks after which the gait gate was open. */
+	uint32_t rejected_blocks;  /* Blocks with motion after which the gait gate was closed.
+	                            * The rest were closed without motion and never reached
+	                            * the gait gate. */
+	uint32_t detected;       /* Samples run through the step stages, catching up included. */
+} step_gate_stats_t;
+
+typedef struct {
+	const step_rate_t *rate;
+
+	/* Steps are detected in the acceleration along gravity, the vertical bounce of
+	 * walking, so sideways sway does not mix in however the device is worn. */
+	gravity_t gravity;
+
+	/* Cascaded band pass filter sections applied to the vertical acceleration,
+	 * settled on the first sample after a reset. */
+	biquad_t highpass;
+	biquad_t lowpass;
+	bool filter_primed;
+
+	/* Running mean and variance of the filtered acceleration used to adapt the threshold. */
+	running_stats_t stats;
+
+	/* A threshold that replaces the adaptive one, in raw units, or 0 to adapt. */
+	int32_t fixed_threshold;
+
+	/* Picks one peak per step out of the thresholded acceleration. */
+	peak_detector_t peaks;
+
+	/* Measures the cadence and confirms steps only while the motion is periodic. */
+	cadence_t cadence;
+
+	/* Checks each sample for any motion, and blocks with motion for power at gait
+	 * frequencies. The step detector only runs while the gait gate is open. */
+	motion_gate_t motion_gate;
+	gait_gate_t gait_gate;
+
+	/* Vertical acceleration of the current gate block. When the gate opens it is run
+	 * through the step detector, so the steps that opened it are still counted. */
+	int32_t block[GAIT_GATE_BLOCK(STEP_DETECTOR_MAX_RATE_HZ)];
+	uint16_t block_length;
+	uint16_t block_count;
+	bool block_motion;
+
+	/* Steps confirmed and samples pushed since init_step_detector. */
+	uint32_t steps;
+	uint32_t samples;
+	step_gate_stats_t gate_stats;
+} step_detector_t;
+
+/* Returns true if the detector has coefficients for the sample rate, 25, 50 or 100Hz. */
+bool step_detector_supports_rate(uint16_t rate_hz);
+
+/* Initializes a detector for samples at rate_hz with no steps counted, settled on
+ * a reading taken at rest. Returns false if the rate is not supported. */
+bool init_step_detector(step_detector_t *detector, uint16_t rate_hz, vector3_t rest);
+
+/* Switches the filters, gate blocks and durations to a new sample rate, carrying
+ * on from the current estimate of gravity. Steps waiting for confirmation are
+ * dropped. Returns false, leaving the detector as it was, if the rate is not
+ * supported. */
+bool set_step_detector_rate(step_detector_t *detector, uint16_t rate_hz);
+
+/* Starts detection afresh from a reading taken at rest, keeping the steps counted. */
+void seed_step_detector(step_detector_t *detector, vector3_t rest);
+
+/* Fixes the step threshold at a level of the filtered vertical acceleration in raw
+ * units, for tools comparing it with the adaptive threshold, or adapts it again if
+ * the threshold is 0. */
+void set_step_threshold(step_detector_t *detector, int32_t threshold);
+
+/* Detects steps from the band pass filtered acceleration along gravity. A step is a
+ * peak above the adaptive threshold that is not within the refractory period of the
+ * previous step, and it only counts once the acceleration around it is found to be
+ * periodic. The detector is skipped while there is no power at gait frequencies.
+ * Takes a block of consecutive samples at the detector's rate as separate x, y and
+ * z arrays, and returns the number of steps they confirmed, which can include steps
+ * that waited for confirmation. A step is confirmed a fraction of a second after its
+ * peak, so its peak can lie in an earlier block. The sample of the peak of each step,
+ * numbered from 0 for the first sample pushed after init_step_detector, is written
+ * to peaks, up to max_peaks of them, so peaks can be 0 if max_peaks is 0. Results do
+ * not depend on how the samples are split into blocks, and larger blocks let each
+ * stage run over many samples in one loop. */
+uint16_t push_step_block(step_detector_t *detector, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint16_t count, uint32_t *peaks, uint16_t max_peaks);
+
+/* Detects steps in consecutive samples, as push_step_block. Returns the number of
+ * steps they confirmed. */
+uint16_t push_step_samples(step_detector_t *detector, const vector3_t *samples, uint16_t count);
+
+/* Returns the steps confirmed since init_step_detector. */
+uint32_t step_detector_count(const step_detector_t *detector);
+
+/* Returns the samples pushed since init_step_detector, the number the next sample
+ * will have. */
+uint32_t step_detector_samples(const step_detector_t *detector);
+
+/* Returns how much the gates have let through since init_step_detector. */
+step_gate_stats_t step_detector_gate_stats(const step_detector_t *detector);
+
+/* Returns the cadence in steps per minute, 0 if not walking or running. */
+uint16_t step_detector_cadence(const step_detector_t *detector);
+
+/* Returns the sample rate in Hz. */
+uint16_t step_detector_rate(const step_detector_t *detector);
+
+/* Returns the current estimate of gravity in raw units. */
+vector3_t step_detector_gravity(const step_detector_t *detector);
+
+#endif /* STEP_DETECTOR_H */
@@ -0,0 +1,229 @@
+/*
+ * File: adxl345_sim.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Simulated ADXL345 register file for running the accelerometer driver on the host.
+ * The I2C stub passes register reads and writes here, and tools set the sample
+ * that the data registers return. Each sample set while measuring is also run
+ * through models of the activity, inactivity and free fall detection, which
+ * raise their events in INT_SOURCE and on the interrupt pins.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "acc.h"
+#include "adxl345_sim.h"
+
+#define ADXL345_DEVID       0x00
+#define ADXL345_DEVID_VALUE 0xE5
+
+static uint8_t registers[ADXL345_SIM_REGISTERS];
+
+/* Offsets are in 15.6mg steps, 4 full resolution LSB each. */
+#define OFFSET_LSB_SCALE 4
+
+static int16_t sample[3];
+
+/* The event thresholds are in 62.5mg steps, 16 full resolution LSB each. */
+#define THRESH_LSB_SCALE 16
+
+/* TIME_INACT is in 1 second steps and TIME_FF in 5ms steps, in 1/3200ths of a second. */
+#define TIME_INACT_SCALE 3200
+#define TIME_FF_SCALE 16
+
+/* Events modeled, cleared by reading INT_SOURCE. */
+#define EVENT_BITS (ACCL_INT_ACTIVITY | ACCL_INT_INACTIVITY | ACCL_INT_FREE_FALL)
+
+/* Readings AC coupled activity and inactivity are measured from. */
+static int32_t activity_reference[3];
+static int32_t inactivity_reference[3];
+
+/* Samples every axis has stayed within the inactivity threshold. */
+static uint32_t inactive_samples;
+
+/* Samples every axis has stayed below the free fall threshold. */
+static uint32_t free_fall_samples;
+
+/* With ACCL_LINK, true while activity is looked for rather than inactivity. */
+static bool awaiting_activity;
+
+/* Returns the reading of an axis with the programmed offset, in full resolution units. */
+static int32_t measured(uint8_t axis) {
+	return sample[axis] + (int8_t) registers[ACCL_OFFSET_X + axis] * OFFSET_LSB_SCALE;
+}
+
+/* Writes the current sample plus the programmed offsets into the data registers,
+ * in the format selected by ACCL_DATA_FORMAT. */
+static void update_data_registers(void) {
+	uint8_t format = registers[ACCL_DATA_FORMAT];
+	uint8_t range = format & 0x03;
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		int32_t value = measured(axis);
+		/* Without full resolution the reading is 10 bits across the whole range. */
+		if ((format & ACCL_FULL_RES) == 0) {
+			value >>= range;
+		}
+		int32_t limit = (format & ACCL_FULL_RES) ? (512 << range) : 512;
+		if (value >= limit) {
+			value = limit - 1;
+		} else if (value < -limit) {
+			value = -limit;
+		}
+		registers[ACCL_DATA_X0 + 2 * axis] = value & 0xFF;
+		registers[ACCL_DATA_X0 + 2 * axis + 1] = (value >> 8) & 0xFF;
+	}
+}
+
+/* Returns the number of samples at the output data rate that last for count
+ * steps of scale / 3200 seconds, at least 1. */
+static uint32_t samples_for(uint8_t count, uint32_t scale) {
+	uint8_t rate = registers[ACCL_BW_RATE] & 0x0F;
+	uint32_t samples = ((uint32_t) count * scale) >> (ACCL_RATE_3200HZ - rate);
+	return samples > 0 ? samples : 1;
+}
+
+/* Sets an event in INT_SOURCE if it is enabled. */
+static void raise_event(uint8_t event) {
+	if (registers[ACCL_INT] & event) {
+		registers[ACCL_INT_SOURCE] |= event;
+	}
+}
+
+/* Starts activity or inactivity detection afresh from the current reading. */
+static void restart_events(bool activity) {
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		activity_reference[axis] = measured(axis);
+		inactivity_reference[axis] = measured(axis);
+	}
+	inactive_samples = 0;
+	free_fall_samples = 0;
+	awaiting_activity = activity;
+}
+
+/* Returns true if any axis enabled by the mask moved beyond the threshold. The
+ * x axis enable is the highest bit of the mask. */
+static bool beyond_threshold(uint8_t enables, uint8_t x_enable, bool ac,
+		const int32_t *reference, int32_t threshold) {
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		if (enables & (x_enable >> axis)) {
+			int32_t deviation = measured(axis) - (ac ? reference[axis] : 0);
+			if ((deviation < 0 ? -deviation : deviation) > threshold) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/* Runs activity, inactivity and free fall detection on a new sample. Linked,
+ * activity is only looked for after inactivity and inactivity after activity. */
+static void update_events(void) {
+	uint8_t control = registers[ACCL_ACT_INACT_CTL];
+	bool link = (registers[ACCL_PWR_CTL] & ACCL_LINK) != 0;
+	bool look_for_inactivity = !link || !awaiting_activity;
+
+	if (!link || awaiting_activity) {
+		if (beyond_threshold(control, 0x40, (control & ACCL_ACT_AC) != 0, activity_reference,
+				registers[ACCL_THRESH_ACT] * THRESH_LSB_SCALE)) {
+			raise_event(ACCL_INT_ACTIVITY);
+			if (link) {
+				restart_events(false);
+			}
+		}
+	}
+
+	if (look_for_inactivity) {
+		bool ac = (control & ACCL_INACT_AC) != 0;
+		if (beyond_threshold(control, 0x04, ac, inactivity_reference,
+				registers[ACCL_THRESH_INACT] * THRESH_LSB_SCALE)) {
+			/* AC coupled, the reference follows each movement. */
+			uint8_t axis;
+			for (axis = 0; axis < 3; axis++) {
+				inactivity_reference[axis] = measured(axis);
+			}
+			inactive_samples = 0;
+		} else if (++inactive_samples
+				== samples_for(registers[ACCL_TIME_INACT], TIME_INACT_SCALE)) {
+			raise_event(ACCL_INT_INACTIVITY);
+			if (link) {
+				restart_events(true);
+			}
+		}
+	}
+
+	int32_t free_fall = registers[ACCL_THRESH_FF] * THRESH_LSB_SCALE;
+	if (beyond_threshold(0x07, 0x04, false, NULL, free_fall - 1)) {
+		free_fall_samples = 0;
+	} else if (++free_fall_samples >= samples_for(registers[ACCL_TIME_FF], TIME_FF_SCALE)) {
+		raise_event(ACCL_INT_FREE_FALL);
+	}
+}
+
+/* Resets every register to its power on value. */
+void adxl345_sim_reset(void) {
+	memset(registers, 0, sizeof(registers));
+	memset(sample, 0, sizeof(sample));
+	registers[ADXL345_DEVID] = ADXL345_DEVID_VALUE;
+	registers[ACCL_BW_RATE] = ACCL_RATE_100HZ;
+	restart_events(false);
+}
+
+/* Sets the reading returned by the data registers. */
+void adxl345_sim_set_sample(int16_t x, int16_t y, int16_t z) {
+	sample[0] = x;
+	sample[1] = y;
+	sample[2] = z;
+	update_data_registers();
+	if (registers[ACCL_PWR_CTL] & ACCL_MEASURE) {
+		update_events();
+	}
+}
+
+/* Reading INT_SOURCE clears the events in it. */
+uint8_t adxl345_sim_read(uint8_t reg) {
+	if (reg >= ADXL345_SIM_REGISTERS) {
+		return 0;
+	}
+	uint8_t value = registers[reg];
+	if (reg == ACCL_INT_SOURCE) {
+		registers[reg] &= ~EVENT_BITS;
+	}
+	return value;
+}
+
+/* Changing the power or activity control starts detection afresh. */
+void adxl345_sim_write(uint8_t reg, uint8_t value) {
+	if (reg < ADXL345_SIM_REGISTERS && reg != ADXL345_DEVID && reg != ACCL_INT_SOURCE) {
+		registers[reg] = value;
+		update_data_registers();
+		if (reg == ACCL_PWR_CTL || reg == ACCL_ACT_INACT_CTL) {
+			restart_events(false);
+		}
+	}
+}
+
+/* Returns the levels of the interrupt pins, bit 0 for INT1 and bit 1 for INT2.
+ * Events are on INT2 if set in INT_MAP, otherwise INT1, active high unless
+ * ACCL_INT_INVERT is set. */
+uint8_t adxl345_sim_int_pins(void) {
+	uint8_t raised = registers[ACCL_INT_SOURCE] & registers[ACCL_INT];
+	uint8_t pins = ((raised & ~registers[ACCL_INT_MAP]) ? 0x01 : 0)
+			| ((raised & registers[ACCL_INT_MAP]) ? 0x02 : 0);
+	if (registers[ACCL_DATA_FORMAT] & ACCL_INT_INVERT) {
+		pins ^= 0x03;
+	}
+	return pins;
+}
+
+/* Returns a register value without any read side effects. */
+uint8_t adxl345_sim_peek(uint8_t reg) {
+	return reg < ADXL345_SIM_REGISTERS ? registers[reg] : 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * File: adxl345_sim.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Simulated ADXL345 register file for running the accelerometer driver on the host.
+ * The I2C stub passes register reads and writes here, and tools set the sample
+ * that the data registers return, one sample per output data period. While
+ * measuring, activity, inactivity and free fall are detected from the samples
+ * like the real part, raising events in INT_SOURCE and on the interrupt pins.
+ */
+
+#ifndef ADXL345_SIM_H
+#define ADXL345_SIM_H
+
+#include <stdint.h>
+
+#define ADXL345_SIM_REGISTERS 0x40
+
+/* Resets every register to its power on value. */
+void adxl345_sim_reset(void);
+
+/* Sets the reading returned by the data registers, as raw full resolution values.
+ * Each call is the next sample at the output data rate in BW_RATE. */
+void adxl345_sim_set_sample(int16_t x, int16_t y, int16_t z);
+
+/* Register access used by the I2C stub. */
+uint8_t adxl345_sim_read(uint8_t reg);
+void adxl345_sim_write(uint8_t reg, uint8_t value);
+
+/* Returns a register value without any read side effects, for tools to inspect. */
+uint8_t adxl345_sim_peek(uint8_t reg);
+
+/* Returns the levels of the interrupt pins, bit 0 for INT1 and bit 1 for INT2. */
+uint8_t adxl345_sim_int_pins(void);
+
+#endif /* ADXL345_SIM_H */
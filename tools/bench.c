@@ -0,0 +1,538 @@
+/*
+ * File: bench.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host benchmarks for the fitness monitor. Each benchmark runs a piece of the
+ * firmware in a loop and reports the time per call and calls per second, where
+ * a call is one sample for the filters and detector. Pass a name prefix to only
+ * run matching benchmarks.
+ *
+ * The dsp/ benchmarks run each kernel in plain C and on packed pairs, with the
+ * DSP instructions emulated, over the same random inputs, and with AVX2 if it is
+ * enabled. All must report the same checksum, which checks they are bit-identical.
+ * dsp_test.c checks them on the extremes of their inputs as well.
+ * Build with and without -mavx2 to compare the detector on the AVX2 kernels
+ * against the plain ones.
+ *
+ * The lanes/ benchmarks count steps in STEP_LANES different walks, one after
+ * another with step_detector.c and all at once with step_lanes.c, and must report
+ * the same total. Rows over walks also give the walks, a minute each, per second.
+ *
+ * Rows that must give the same result as an earlier row are compared when both
+ * run, and bench exits with 1 if any differ.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -Itools/include -Itools -I. tools/bench.c \
+ *       format.c ustdlib.c biquad.c goertzel.c gait_gate.c motion_gate.c gravity.c \
+ *       running_stats.c peak_detector.c cadence.c step_detector.c dsp.c \
+ *       tools/step_lanes.c -lm -o bench
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "utils/ustdlib.h"
+#include "format.h"
+#include "biquad.h"
+#include "gait_gate.h"
+#include "motion_gate.h"
+#include "accelerometer.h"
+#include "step_detector.h"
+#include "dsp.h"
+#include "step_lanes.h"
+
+/* Calls per benchmark. */
+#define ITERATIONS 1000000
+
+typedef struct {
+	const char *name;
+	/* Runs the benchmarked code iterations times and returns a value so the work is not optimised away. */
+	uint32_t (*run)(uint32_t iterations);
+	/* Calls per walk for rows over walks, otherwise 0. */
+	uint32_t walk_length;
+	/* Earlier row whose result this row must equal when both run, or NULL. */
+	const char *same_as;
+} bench_t;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Display formats as used by display.c before and after the formatter was added.
+ * The values cycle through the range the display shows. */
+
+static uint32_t usnprintf_val(uint32_t iterations) {
+	char buf[17];
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		sum += usnprintf(buf, sizeof(buf), "%s: %d", "New Goal", i % 10001);
+	}
+	return sum + buf[0];
+}
+
+static uint32_t format_val(uint32_t iterations) {
+	char buf[32];
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		uint8_t len = format_text(buf, "New Goal");
+		len += format_text(buf + len, ": ");
+		sum += len + format_uint(buf + len, i % 10001, 0, ' ');
+	}
+	return sum + buf[0];
+}
+
+static uint32_t usnprintf_steps(uint32_t iterations) {
+	char buf[17];
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		sum += usnprintf(buf, sizeof(buf), "%d %s", i % 10001, "steps");
+	}
+	return sum + buf[0];
+}
+
+static uint32_t format_steps(uint32_t iterations) {
+	char buf[32];
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		uint8_t len = format_uint(buf, i % 10001, 0, ' ');
+		buf[len++] = ' ';
+		sum += len + format_text(buf + len, "steps");
+	}
+	return sum + buf[0];
+}
+
+static uint32_t usnprintf_val_units(uint32_t iterations) {
+	char buf[17];
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		uint32_t value = i % 9001;
+		sum += usnprintf(buf, sizeof(buf), "%s%d.%03d %s", "Dist: ",
+				value / 1000, value % 1000, "km");
+	}
+	return sum + buf[0];
+}
+
+static uint32_t format_val_units(uint32_t iterations) {
+	char buf[32];
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		uint8_t len = format_text(buf, "Dist: ");
+		len += format_fixed(buf + len, i % 9001, 3);
+		buf[len++] = ' ';
+		sum += len + format_text(buf + len, "km");
+	}
+	return sum + buf[0];
+}
+
+/* The step band pass filter as configured in accelerometer.c at 50Hz, on a
+ * magnitude swinging around 1g with 8 fractional bits. */
+static uint32_t bandpass(uint32_t iterations) {
+	static const biquad_coefs_t highpass_coefs = BIQUAD_HIGHPASS(0.5, 50);
+	static const biquad_coefs_t lowpass_coefs = BIQUAD_LOWPASS(5.0, 50);
+	biquad_t highpass;
+	biquad_t lowpass;
+	init_biquad(&highpass, &highpass_coefs, 256 << 8, 0);
+	init_biquad(&lowpass, &lowpass_coefs, 0, 0);
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		int32_t magnitude = (256 + (int32_t) (i % 25) * 4 - 48) << 8;
+		sum += update_biquad(&lowpass, update_biquad(&highpass, magnitude));
+	}
+	return sum;
+}
+
+/* Vertical acceleration of a reading at rest with a little noise, in raw units
+ * with 8 fractional bits. */
+static int32_t rest_vertical(uint32_t i) {
+	return (256 + (int32_t) (i % 5) - 2) << 8;
+}
+
+/* The gait gate as configured in accelerometer.c at 50Hz, per sample of the
+ * blocks it filters. */
+static uint32_t gait_gate(uint32_t iterations) {
+	static const int32_t coefs[GAIT_GATE_BINS] = GAIT_GATE_COEFS(50);
+	int32_t block[GAIT_GATE_BLOCK(50)];
+	gait_gate_t gate;
+	init_gait_gate(&gate, coefs, GAIT_GATE_BLOCK(50));
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		block[i % GAIT_GATE_BLOCK(50)] = rest_vertical(i);
+		if (i % GAIT_GATE_BLOCK(50) == GAIT_GATE_BLOCK(50) - 1) {
+			update_gait_gate(&gate, block);
+			sum += gait_gate_open(&gate);
+		}
+	}
+	return sum;
+}
+
+/* The motion gate as configured in accelerometer.c at 50Hz, the first stage
+ * every sample goes through. */
+static uint32_t motion_gate(uint32_t iterations) {
+	motion_gate_t gate;
+	init_motion_gate(&gate, 256 << 8, (256 << 8) / 32, GAIT_GATE_BLOCK(50));
+	uint32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i < iterations; i++) {
+		sum += update_motion_gate(&gate, rest_vertical(i));
+	}
+	return sum;
+}
+
+/* A minute of walking at 50Hz, 108 steps per minute with the device upright. The
+ * bounce is along z, with a little sway along x at half the step rate and noise
+ * from a fixed seed. Whole blocks of 256 fit, so every block size wraps alike. */
+#define WALK_RATE_HZ 50
+#define WALK_LENGTH 3072
+#define PI 3.14159265358979323846
+static int16_t walk_x[WALK_LENGTH];
+static int16_t walk_y[WALK_LENGTH];
+static int16_t walk_z[WALK_LENGTH];
+
+static void make_walk(void) {
+	uint32_t seed = 361;
+	uint32_t i;
+	for (i = 0; i < WALK_LENGTH; i++) {
+		double t = (double) i / WALK_RATE_HZ;
+		seed = seed * 1103515245 + 12345;
+		int32_t noise = (int32_t) ((seed >> 16) % 7) - 3;
+		walk_x[i] = (int16_t) (24 * sin(2 * PI * 0.9 * t)) + noise;
+		walk_y[i] = noise;
+		walk_z[i] = (int16_t) (256 + 90 * sin(2 * PI * 1.8 * t)) - noise;
+	}
+}
+
+/* The step detector at 50Hz fed the walk in blocks of block_size samples, as
+ * push_step_block is used by tools. Returns the steps counted, which must be the
+ * same for every block size. */
+static uint32_t detector_blocks(uint32_t iterations, uint16_t block_size) {
+	static bool walk_made = false;
+	if (!walk_made) {
+		make_walk();
+		walk_made = true;
+	}
+	vector3_t rest = { 0, 0, 256 };
+	step_detector_t detector;
+	init_step_detector(&detector, WALK_RATE_HZ, rest);
+	uint32_t peaks[256];
+	uint32_t done = 0;
+	while (done < iterations) {
+		uint32_t start = done % WALK_LENGTH;
+		uint32_t n = block_size;
+		if (n > iterations - done) {
+			n = iterations - done;
+		}
+		push_step_block(&detector, walk_x + start, walk_y + start, walk_z + start, n,
+				peaks, sizeof(peaks) / sizeof(peaks[0]));
+		done += n;
+	}
+	return step_detector_count(&detector);
+}
+
+static uint32_t detector_block_1(uint32_t iterations) {
+	return detector_blocks(iterations, 1);
+}
+
+static uint32_t detector_block_16(uint32_t iterations) {
+	return detector_blocks(iterations, 16);
+}
+
+static uint32_t detector_block_256(uint32_t iterations) {
+	return detector_blocks(iterations, 256);
+}
+
+/* The step detector at 50Hz fed a device at rest in blocks of 256, the common case
+ * in recordings, where the gates skip everything after the projection onto gravity. */
+static uint32_t detector_rest_256(uint32_t iterations) {
+	int16_t x[256];
+	int16_t y[256];
+	int16_t z[256];
+	uint32_t seed = 361;
+	uint16_t i;
+	for (i = 0; i < 256; i++) {
+		seed = seed * 1103515245 + 12345;
+		int16_t noise = (int16_t) ((seed >> 16) % 5) - 2;
+		x[i] = 12 + noise;
+		y[i] = -20 - noise;
+		z[i] = 250 + noise;
+	}
+	vector3_t rest = { 12, -20, 250 };
+	step_detector_t detector;
+	init_step_detector(&detector, WALK_RATE_HZ, rest);
+	uint32_t done;
+	for (done = 0; done < iterations; done += 256) {
+		push_step_block(&detector, x, y, z, 256, 0, 0);
+	}
+	return step_detector_count(&detector) + step_detector_gravity(&detector).z;
+}
+
+/* STEP_LANES walks for the lanes, each at its own cadence, strength of step and
+ * tilt, and every third standing still for the first half. Sample i of walk l
+ * is at i * STEP_LANES + l. */
+static int16_t lanes_x[WALK_LENGTH * STEP_LANES];
+static int16_t lanes_y[WALK_LENGTH * STEP_LANES];
+static int16_t lanes_z[WALK_LENGTH * STEP_LANES];
+
+/* Returns the reading walk l rests at. */
+static vector3_t lane_rest(uint8_t l) {
+	vector3_t rest = { (int16_t) (20 * l - 70), 0, 256 };
+	return rest;
+}
+
+static void make_lane_walks(void) {
+	static bool made = false;
+	uint32_t seed = 361;
+	uint32_t i;
+	uint8_t l;
+	if (made) {
+		return;
+	}
+	for (i = 0; i < WALK_LENGTH; i++) {
+		double t = (double) i / WALK_RATE_HZ;
+		for (l = 0; l < STEP_LANES; l++) {
+			double step_hz = 1.5 + 0.12 * l;
+			double amplitude = l % 3 == 2 && i < WALK_LENGTH / 2 ? 0 : 50 + 8 * l;
+			vector3_t rest = lane_rest(l);
+			seed = seed * 1103515245 + 12345;
+			int32_t noise = (int32_t) ((seed >> 16) % 7) - 3;
+			lanes_x[i * STEP_LANES + l] = rest.x
+					+ (int16_t) (amplitude / 4 * sin(PI * step_hz * t)) + noise;
+			lanes_y[i * STEP_LANES + l] = noise;
+			lanes_z[i * STEP_LANES + l] = rest.z
+					+ (int16_t) (amplitude * sin(2 * PI * step_hz * t)) - noise;
+		}
+	}
+	made = true;
+}
+
+/* The step detector at 50Hz on each walk in turn, fed in blocks of 256, with
+ * iterations samples across all walks. */
+static uint32_t lanes_scalar(uint32_t iterations) {
+	int16_t x[256];
+	int16_t y[256];
+	int16_t z[256];
+	uint32_t steps = 0;
+	uint8_t l;
+	make_lane_walks();
+	for (l = 0; l < STEP_LANES; l++) {
+		step_detector_t detector;
+		init_step_detector(&detector, WALK_RATE_HZ, lane_rest(l));
+		uint32_t done;
+		for (done = 0; done < iterations / STEP_LANES; done += 256) {
+			uint32_t start = done % WALK_LENGTH;
+			uint16_t i;
+			for (i = 0; i < 256; i++) {
+				x[i] = lanes_x[(start + i) * STEP_LANES + l];
+				y[i] = lanes_y[(start + i) * STEP_LANES + l];
+				z[i] = lanes_z[(start + i) * STEP_LANES + l];
+			}
+			push_step_block(&detector, x, y, z, 256, 0, 0);
+		}
+		steps += step_detector_count(&detector);
+	}
+	return steps;
+}
+
+/* The same walks all at once in the lanes. */
+static uint32_t lanes_simd(uint32_t iterations) {
+	step_detector_t detectors[STEP_LANES];
+	static step_lanes_t lanes;
+	uint32_t steps = 0;
+	uint8_t l;
+	make_lane_walks();
+	for (l = 0; l < STEP_LANES; l++) {
+		init_step_detector(&detectors[l], WALK_RATE_HZ, lane_rest(l));
+	}
+	load_step_lanes(&lanes, detectors);
+	uint32_t done;
+	for (done = 0; done < iterations / STEP_LANES; done += 256) {
+		uint32_t start = (done % WALK_LENGTH) * STEP_LANES;
+		push_step_lanes(&lanes, lanes_x + start, lanes_y + start, lanes_z + start, 256);
+	}
+	for (l = 0; l < STEP_LANES; l++) {
+		steps += step_lanes_count(&lanes, l);
+	}
+	return steps;
+}
+
+/* Random inputs for the kernels from a fixed seed. */
+#define KERNEL_BLOCK 256
+static uint32_t kernel_seed;
+
+static int32_t kernel_random(int32_t min, int32_t max) {
+	kernel_seed = kernel_seed * 1103515245 + 12345;
+	return min + (int32_t) ((kernel_seed >> 8) % (uint32_t) (max - min + 1));
+}
+
+/* Projections of 13 bit readings onto random Q14 unit vectors, per reading. */
+static uint32_t project(uint32_t iterations, void (*kernel)(const int16_t *, const int16_t *,
+		const int16_t *, uint16_t, const int32_t *, uint8_t, int32_t *)) {
+	int16_t x[KERNEL_BLOCK];
+	int16_t y[KERNEL_BLOCK];
+	int16_t z[KERNEL_BLOCK];
+	int32_t out[KERNEL_BLOCK];
+	uint32_t sum = 0;
+	uint32_t i;
+	kernel_seed = 1;
+	for (i = 0; i < KERNEL_BLOCK; i++) {
+		x[i] = kernel_random(-4096, 4095);
+		y[i] = kernel_random(-4096, 4095);
+		z[i] = kernel_random(-4096, 4095);
+	}
+	for (i = 0; i < iterations; i += KERNEL_BLOCK) {
+		int32_t unit[3] = { kernel_random(-16384, 16384), kernel_random(-16384, 16384),
+				kernel_random(-16384, 16384) };
+		kernel(x, y, z, KERNEL_BLOCK, unit, 6, out);
+		uint16_t j;
+		for (j = 0; j < KERNEL_BLOCK; j++) {
+			sum = sum * 31 + out[j];
+		}
+	}
+	return sum;
+}
+
+static uint32_t project_c(uint32_t iterations) {
+	return project(iterations, dsp_project_c);
+}
+
+static uint32_t project_packed(uint32_t iterations) {
+	return project(iterations, dsp_project_packed);
+}
+
+/* The AMDF slid over the full int16 range at the 35 lags of the cadence
+ * estimator, per lag. */
+static uint32_t slide_amdf(uint32_t iterations, void (*kernel)(uint32_t *, uint16_t, int16_t,
+		const int16_t *, int16_t, const int16_t *)) {
+	int16_t history[KERNEL_BLOCK];
+	uint32_t sums[CADENCE_LAGS] = { 0 };
+	uint32_t i;
+	kernel_seed = 2;
+	for (i = 0; i < KERNEL_BLOCK; i++) {
+		history[i] = kernel_random(INT16_MIN, INT16_MAX);
+	}
+	for (i = 0; i < iterations; i += CADENCE_LAGS) {
+		int16_t entering = kernel_random(INT16_MIN, INT16_MAX);
+		int16_t leaving = kernel_random(INT16_MIN, INT16_MAX);
+		uint16_t start = kernel_random(CADENCE_LAGS, KERNEL_BLOCK - 1);
+		kernel(sums, CADENCE_LAGS, entering, history + start, leaving,
+				history + (start + 97) % (KERNEL_BLOCK - CADENCE_LAGS) + CADENCE_LAGS);
+	}
+	uint32_t sum = 0;
+	for (i = 0; i < CADENCE_LAGS; i++) {
+		sum = sum * 31 + sums[i];
+	}
+	return sum;
+}
+
+static uint32_t slide_amdf_c(uint32_t iterations) {
+	return slide_amdf(iterations, dsp_slide_amdf_c);
+}
+
+static uint32_t slide_amdf_packed(uint32_t iterations) {
+	return slide_amdf(iterations, dsp_slide_amdf_packed);
+}
+
+#if defined(__AVX2__)
+static uint32_t project_avx2(uint32_t iterations) {
+	return project(iterations, dsp_project_avx2);
+}
+
+static uint32_t slide_amdf_avx2(uint32_t iterations) {
+	return slide_amdf(iterations, dsp_slide_amdf_avx2);
+}
+#endif
+
+static const bench_t benchmarks[] = {
+	{ "format/usnprintf_val", usnprintf_val, 0, NULL },
+	{ "format/format_val", format_val, 0, NULL },
+	{ "format/usnprintf_steps", usnprintf_steps, 0, NULL },
+	{ "format/format_steps", format_steps, 0, NULL },
+	{ "format/usnprintf_val_units", usnprintf_val_units, 0, NULL },
+	{ "format/format_val_units", format_val_units, 0, NULL },
+	{ "filter/bandpass", bandpass, 0, NULL },
+	{ "filter/gait_gate", gait_gate, 0, NULL },
+	{ "filter/motion_gate", motion_gate, 0, NULL },
+	{ "detector/block_1", detector_block_1, WALK_LENGTH, NULL },
+	{ "detector/block_16", detector_block_16, WALK_LENGTH, NULL },
+	{ "detector/block_256", detector_block_256, WALK_LENGTH, NULL },
+	{ "detector/rest_256", detector_rest_256, WALK_LENGTH, NULL },
+	{ "lanes/scalar", lanes_scalar, WALK_LENGTH, NULL },
+	{ "lanes/simd", lanes_simd, WALK_LENGTH, "lanes/scalar" },
+	{ "dsp/project_c", project_c, 0, NULL },
+	{ "dsp/project_packed", project_packed, 0, "dsp/project_c" },
+#if defined(__AVX2__)
+	{ "dsp/project_avx2", project_avx2, 0, "dsp/project_c" },
+#endif
+	{ "dsp/slide_amdf_c", slide_amdf_c, 0, NULL },
+	{ "dsp/slide_amdf_packed", slide_amdf_packed, 0, "dsp/slide_amdf_c" },
+#if defined(__AVX2__)
+	{ "dsp/slide_amdf_avx2", slide_amdf_avx2, 0, "dsp/slide_amdf_c" },
+#endif
+};
+
+#define BENCH_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/* Returns true if the row's result matches the row it must equal, or there is
+ * nothing to compare it with. */
+static bool check_same_as(const bench_t *bench, uint32_t result, const uint32_t *results,
+		const bool *ran) {
+	uint32_t i;
+	if (bench->same_as == NULL) {
+		return true;
+	}
+	for (i = 0; i < BENCH_COUNT; i++) {
+		if (ran[i] && strcmp(benchmarks[i].name, bench->same_as) == 0 && results[i] != result) {
+			printf("%s gave %u but %s gave %u\n", bench->name, result, bench->same_as,
+					results[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	const char *filter = argc > 1 ? argv[1] : "";
+	uint32_t results[BENCH_COUNT];
+	bool ran[BENCH_COUNT] = { false };
+	bool failed = false;
+	uint32_t i;
+	for (i = 0; i < BENCH_COUNT; i++) {
+		const bench_t *bench = &benchmarks[i];
+		if (strncmp(bench->name, filter, strlen(filter)) != 0) {
+			continue;
+		}
+		uint64_t start = now_ns();
+		uint32_t result = bench->run(ITERATIONS);
+		uint64_t elapsed = now_ns() - start;
+		printf("%-36s %8.1f ns/call %8.2f M/s", bench->name,
+				(double) elapsed / ITERATIONS, ITERATIONS * 1000.0 / elapsed);
+		if (bench->walk_length != 0) {
+			printf(" %8.0f walks/s", ITERATIONS * 1e9 / bench->walk_length / elapsed);
+		}
+		printf("  (%u)\n", result);
+		if (!check_same_as(bench, result, results, ran)) {
+			failed = true;
+		}
+		results[i] = result;
+		ran[i] = true;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * File: display_test.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Checks the display queue in display.c against the OLED mock:
+ *   - posted text is only drawn by display_flush, never more than the
+ *     characters it is allowed per call, and ends up on the frame as posted,
+ *   - only characters that differ from the frame are drawn again,
+ *   - text past the edge of the display and rows below it are dropped,
+ *   - display_blank clears the frame at once, text posted while blanked is not
+ *     drawn, and all of it is drawn after display_unblank,
+ *   - the goal reached screen, with the distance as km to two decimal places,
+ *   - every raw reading shown in each acceleration unit.
+ * Prints the first few mismatches of each check and exits with 1 if any fail.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -Itools/include -Itools -I. tools/display_test.c display.c format.c tools/oled_mock.c -o display_test
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "display.h"
+#include "oled_mock.h"
+
+/* Characters per flush, as main draws them. */
+#define FLUSH_CHARS 4
+
+/* Flushes given up on, the whole frame takes 16 at FLUSH_CHARS. */
+#define MAX_FLUSHES 64
+
+/* Mismatches printed per check. */
+#define MAX_REPORTED 5
+
+static uint32_t failures;
+
+/* Counts a mismatch, printing the first few of a check. */
+static void report(uint32_t *mismatches, const char *what, const char *got,
+		const char *expected) {
+	if (*mismatches < MAX_REPORTED) {
+		printf("  %s: \"%s\", expected \"%s\"\n", what, got, expected);
+	}
+	(*mismatches)++;
+}
+
+/* Counts a mismatch between two numbers. */
+static void report_count(uint32_t *mismatches, const char *what, uint32_t got,
+		uint32_t expected) {
+	char got_text[12];
+	char expected_text[12];
+	snprintf(got_text, sizeof(got_text), "%u", got);
+	snprintf(expected_text, sizeof(expected_text), "%u", expected);
+	report(mismatches, what, got_text, expected_text);
+}
+
+/* Prints the result of a check and adds its mismatches to the failures. */
+static void finish(const char *check, uint32_t mismatches) {
+	printf("%s: %s, %u wrong\n", check, mismatches ? "FAIL" : "ok", mismatches);
+	failures += mismatches;
+}
+
+/* Checks a row of the frame shows text, padded with spaces. */
+static void expect_row(uint32_t *mismatches, uint8_t row, const char *text) {
+	char expected[OLED_MOCK_COLS + 1];
+	snprintf(expected, sizeof(expected), "%-*s", OLED_MOCK_COLS, text);
+	if (strcmp(oled_mock_row(row), expected) != 0) {
+		char what[8];
+		snprintf(what, sizeof(what), "row %u", row);
+		report(mismatches, what, oled_mock_row(row), expected);
+	}
+}
+
+/* Returns the characters drawn since the last reset. */
+static uint32_t chars_drawn(void) {
+	return oled_mock_stats().chars_drawn;
+}
+
+/* Flushes until nothing is left to draw, checking no flush draws more than
+ * FLUSH_CHARS. Returns the number of flushes. */
+static uint32_t flush_all(uint32_t *mismatches) {
+	uint32_t flushes = 0;
+	while (display_busy() && flushes < MAX_FLUSHES) {
+		uint32_t before = chars_drawn();
+		display_flush(FLUSH_CHARS);
+		if (chars_drawn() - before > FLUSH_CHARS) {
+			report_count(mismatches, "chars per flush", chars_drawn() - before, FLUSH_CHARS);
+		}
+		flushes++;
+	}
+	if (display_busy()) {
+		report(mismatches, "display_busy after flushing", "true", "false");
+	}
+	return flushes;
+}
+
+static void check_flush(void) {
+	uint32_t mismatches = 0;
+	initDisplay();
+	display_string("Steps: 123", 0, 1);
+	display_string("Goal", 12, 3);
+	if (!display_busy()) {
+		report(&mismatches, "display_busy after posting", "false", "true");
+	}
+	if (oled_mock_stats().draw_calls != 0) {
+		report_count(&mismatches, "draws before flushing", oled_mock_stats().draw_calls, 0);
+	}
+	uint32_t flushes = flush_all(&mismatches);
+	expect_row(&mismatches, 0, "");
+	expect_row(&mismatches, 1, "Steps: 123");
+	expect_row(&mismatches, 2, "");
+	expect_row(&mismatches, 3, "            Goal");
+	/* The space in "Steps: 123" is already on the frame, so 13 characters. */
+	if (chars_drawn() != 13) {
+		report_count(&mismatches, "chars drawn", chars_drawn(), 13);
+	}
+	if (flushes != 4) {
+		report_count(&mismatches, "flushes", flushes, 4);
+	}
+	finish("flush", mismatches);
+}
+
+static void check_differences(void) {
+	uint32_t mismatches = 0;
+	initDisplay();
+	display_string("Steps: 123", 0, 1);
+	flush_all(&mismatches);
+	const oled_draw_t *log;
+	uint32_t before = oled_mock_log(&log);
+	display_string("Steps: 123", 0, 1);
+	flush_all(&mismatches);
+	if (oled_mock_log(&log) != before) {
+		report_count(&mismatches, "draws of unchanged text", oled_mock_log(&log) - before, 0);
+	}
+	display_string("Steps: 124", 0, 1);
+	flush_all(&mismatches);
+	uint32_t draws = oled_mock_log(&log) - before;
+	log += before;
+	if (draws != 1) {
+		report_count(&mismatches, "draws of one changed character", draws, 1);
+	} else if (log[0].col != 9 || log[0].row != 1 || strcmp(log[0].text, "4") != 0) {
+		char got[OLED_MOCK_COLS + 16];
+		snprintf(got, sizeof(got), "%s at %u,%u", log[0].text, log[0].col, log[0].row);
+		report(&mismatches, "changed character", got, "4 at 9,1");
+	}
+	expect_row(&mismatches, 1, "Steps: 124");
+	finish("differences", mismatches);
+}
+
+static void check_clipping(void) {
+	uint32_t mismatches = 0;
+	initDisplay();
+	display_string("0123456789ABCDEFGH", 10, 0);
+	display_string("Dropped", 0, 4);
+	flush_all(&mismatches);
+	expect_row(&mismatches, 0, "          012345");
+	uint8_t row;
+	for (row = 1; row < OLED_MOCK_ROWS; row++) {
+		expect_row(&mismatches, row, "");
+	}
+	finish("clipping", mismatches);
+}
+
+static void check_blank(void) {
+	uint32_t mismatches = 0;
+	initDisplay();
+	display_string("Before", 0, 0);
+	flush_all(&mismatches);
+	display_blank();
+	uint8_t row;
+	for (row = 0; row < OLED_MOCK_ROWS; row++) {
+		expect_row(&mismatches, row, "");
+	}
+	display_string("While blanked", 0, 2);
+	if (display_busy()) {
+		report(&mismatches, "display_busy while blanked", "true", "false");
+	}
+	uint32_t before = oled_mock_stats().draw_calls;
+	display_flush(FLUSH_CHARS);
+	if (oled_mock_stats().draw_calls != before) {
+		report_count(&mismatches, "draws while blanked", oled_mock_stats().draw_calls - before, 0);
+	}
+	display_unblank();
+	if (!display_busy()) {
+		report(&mismatches, "display_busy after unblanking", "false", "true");
+	}
+	flush_all(&mismatches);
+	expect_row(&mismatches, 0, "Before");
+	expect_row(&mismatches, 1, "");
+	expect_row(&mismatches, 2, "While blanked");
+	expect_row(&mismatches, 3, "");
+	finish("blank", mismatches);
+}
+
+/* The distance is in meters and shown as km, truncated to two decimal places. */
+static void check_goal_reached(void) {
+	static const uint16_t distances[] = { 0, 5, 9, 10, 999, 1000, 1050, 1234, 9999, 65535 };
+	uint32_t mismatches = 0;
+	uint8_t i;
+	for (i = 0; i < sizeof(distances) / sizeof(distances[0]); i++) {
+		char expected[OLED_MOCK_COLS + 1];
+		initDisplay();
+		display_goal_reached(1234, distances[i], 1000);
+		flush_all(&mismatches);
+		expect_row(&mismatches, 0, "*GOAL COMPLETE*");
+		expect_row(&mismatches, 1, "Step Goal: 1000");
+		expect_row(&mismatches, 2, "Steps: 1234");
+		snprintf(expected, sizeof(expected), "Km: %u.%02u", distances[i] / 1000,
+				distances[i] % 1000 / 10);
+		expect_row(&mismatches, 3, expected);
+	}
+	finish("goal reached", mismatches);
+}
+
+/* Every raw reading in each unit. The references scale the reading in long double,
+ * where exact halves stay exact, round them away from zero as the conversions do
+ * and print the thousandths with integer formatting. */
+static void check_accl(void) {
+	static const char *const unit_text[DISPLAY_UNIT_COUNT] = { "raw", "g", "m/s2" };
+	static const long double scales[DISPLAY_UNIT_COUNT] = { 1, 1000.0L / 256, 980665.0L / 25600 };
+	uint32_t mismatches = 0;
+	int32_t raw;
+	initDisplay();
+	for (raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+		display_unit unit;
+		for (unit = DISPLAY_RAW; unit < DISPLAY_UNIT_COUNT; unit++) {
+			char expected[32];
+			long double scaled = raw * scales[unit];
+			long long value = (long long) (scaled < 0 ? -floorl(-scaled + 0.5L) : floorl(scaled + 0.5L));
+			long long magnitude = value < 0 ? -value : value;
+			if (unit == DISPLAY_RAW) {
+				snprintf(expected, sizeof(expected), "X: %lld raw", value);
+			} else {
+				snprintf(expected, sizeof(expected), "X: %s%lld.%03lld %s", value < 0 ? "-" : "",
+						magnitude / 1000, magnitude % 1000, unit_text[unit]);
+			}
+			expected[OLED_MOCK_COLS] = '\0';
+			display_accl("X", raw, unit, 1);
+			flush_all(&mismatches);
+			expect_row(&mismatches, 1, expected);
+		}
+	}
+	finish("acceleration", mismatches);
+}
+
+int main(void) {
+	check_flush();
+	check_differences();
+	check_clipping();
+	check_blank();
+	check_goal_reached();
+	check_accl();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * File: dsp_test.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Checks every version of the kernels in dsp.c gives the same results as the
+ * plain C versions on the same inputs: random readings and sums mixed with the
+ * extremes each kernel accepts, every count up to past the widest vector, every
+ * shift and histories at every alignment. The kernels must also leave the output
+ * past count alone. Prints the first few mismatches of each check and exits
+ * with 1 if any fail.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -I. tools/dsp_test.c dsp.c -o dsp_test
+ * and add -mavx2 to check the AVX2 versions too.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dsp.h"
+
+typedef void (*project_fn)(const int16_t *, const int16_t *, const int16_t *, uint16_t,
+		const int32_t *, uint8_t, int32_t *);
+typedef void (*slide_amdf_fn)(uint32_t *, uint16_t, int16_t, const int16_t *, int16_t,
+		const int16_t *);
+
+typedef struct {
+	const char *name;
+	project_fn project;
+	slide_amdf_fn slide_amdf;
+} kernels_t;
+
+/* The versions checked against dsp_project_c and dsp_slide_amdf_c. */
+static const kernels_t kernels[] = {
+	{ "packed", dsp_project_packed, dsp_slide_amdf_packed },
+#if defined(__AVX2__)
+	{ "avx2", dsp_project_avx2, dsp_slide_amdf_avx2 },
+#endif
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+/* Random inputs checked per count. */
+#define TRIALS 2000
+
+/* Largest count checked, past two of the widest vectors and the cadence lags. */
+#define MAX_COUNT 40
+
+/* History each side of the slide, enough for MAX_COUNT lags at every alignment. */
+#define HISTORY (MAX_COUNT + 16)
+
+/* Fills the output past count so writes there are noticed. */
+#define GUARD 0x5A5A5A5A
+
+/* Mismatches printed per check. */
+#define MAX_REPORTED 5
+
+static uint32_t failures;
+static uint32_t seed = 1;
+
+/* xorshift32, the same inputs every run. */
+static uint32_t random_u32(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* A value from min to max, one time in four an extreme or a value next to zero. */
+static int32_t random_value(int32_t min, int32_t max) {
+	uint32_t pick = random_u32();
+	switch (pick % 16) {
+	case 0:
+		return min;
+	case 1:
+		return max;
+	case 2:
+		return min < 0 ? -1 : min;
+	case 3:
+		return 0 >= min && 0 <= max ? 0 : max;
+	default:
+		return min + (int32_t) ((pick >> 4) % (uint32_t) (max - min + 1));
+	}
+}
+
+/* Counts a mismatch, printing the first few of a check. */
+static void report(uint32_t *mismatches, const char *what, uint16_t count, uint16_t index,
+		uint32_t got, uint32_t expected) {
+	if (*mismatches < MAX_REPORTED) {
+		printf("  %s count %u at %u: %d, expected %d\n", what, count, index, (int32_t) got,
+				(int32_t) expected);
+	}
+	(*mismatches)++;
+}
+
+/* Prints the result of a check and adds its mismatches to the failures. */
+static void finish(const char *check, const char *name, uint32_t mismatches, uint32_t checked) {
+	printf("%s %s: %s, %u checked, %u wrong\n", check, name, mismatches ? "FAIL" : "ok", checked,
+			mismatches);
+	failures += mismatches;
+}
+
+/* Readings over the 13 bit accelerometer range and unit components to +-2^14, the
+ * limits dsp_project takes, at every shift a 32 bit projection can use. */
+static void check_project(const kernels_t *version) {
+	int16_t x[MAX_COUNT];
+	int16_t y[MAX_COUNT];
+	int16_t z[MAX_COUNT];
+	int32_t expected[MAX_COUNT + 1];
+	int32_t got[MAX_COUNT + 1];
+	uint32_t mismatches = 0;
+	uint32_t checked = 0;
+	uint16_t count;
+	seed = 1;
+	for (count = 0; count <= MAX_COUNT; count++) {
+		uint32_t trial;
+		for (trial = 0; trial < TRIALS; trial++) {
+			int32_t unit[3];
+			uint8_t shift = trial % 32;
+			uint16_t i;
+			for (i = 0; i < 3; i++) {
+				unit[i] = random_value(-16384, 16384);
+			}
+			for (i = 0; i < count; i++) {
+				x[i] = random_value(-4096, 4095);
+				y[i] = random_value(-4096, 4095);
+				z[i] = random_value(-4096, 4095);
+			}
+			for (i = 0; i <= MAX_COUNT; i++) {
+				expected[i] = GUARD;
+				got[i] = GUARD;
+			}
+			dsp_project_c(x, y, z, count, unit, shift, expected);
+			version->project(x, y, z, count, unit, shift, got);
+			for (i = 0; i <= MAX_COUNT; i++) {
+				if (got[i] != expected[i]) {
+					report(&mismatches, "project", count, i, got[i], expected[i]);
+				}
+			}
+			checked++;
+		}
+	}
+	finish("project", version->name, mismatches, checked);
+}
+
+/* Samples over the full int16 range, whose differences only just fit in 16 bits
+ * unsigned, into sums that start next to wrapping around 2^32 as often as not. */
+static void check_slide_amdf(const kernels_t *version) {
+	int16_t history[2 * HISTORY];
+	uint32_t expected[MAX_COUNT + 1];
+	uint32_t got[MAX_COUNT + 1];
+	uint32_t mismatches = 0;
+	uint32_t checked = 0;
+	uint16_t count;
+	seed = 2;
+	for (count = 0; count <= MAX_COUNT; count++) {
+		uint32_t trial;
+		for (trial = 0; trial < TRIALS; trial++) {
+			uint16_t i;
+			for (i = 0; i < 2 * HISTORY; i++) {
+				history[i] = random_value(INT16_MIN, INT16_MAX);
+			}
+			for (i = 0; i <= MAX_COUNT; i++) {
+				expected[i] = i < count ? (trial % 2 ? (uint32_t) random_value(-65536, 65535)
+						: random_u32()) : GUARD;
+				got[i] = expected[i];
+			}
+			int16_t entering = random_value(INT16_MIN, INT16_MAX);
+			int16_t leaving = random_value(INT16_MIN, INT16_MAX);
+			/* The newest sample of each history, far enough in for count lags
+			 * back, at every alignment of the pairs and vectors read. */
+			const int16_t *entering_history = history + MAX_COUNT + trial % 16;
+			const int16_t *leaving_history = history + HISTORY + MAX_COUNT - 1 - trial % 16;
+			uint8_t slides = 1 + trial % 3;
+			uint8_t slide;
+			for (slide = 0; slide < slides; slide++) {
+				dsp_slide_amdf_c(expected, count, entering, entering_history, leaving,
+						leaving_history);
+				version->slide_amdf(got, count, entering, entering_history, leaving,
+						leaving_history);
+			}
+			for (i = 0; i <= MAX_COUNT; i++) {
+				if (got[i] != expected[i]) {
+					report(&mismatches, "slide_amdf", count, i, got[i], expected[i]);
+				}
+			}
+			checked++;
+		}
+	}
+	finish("slide_amdf", version->name, mismatches, checked);
+}
+
+int main(void) {
+	uint32_t i;
+	for (i = 0; i < KERNEL_COUNT; i++) {
+		check_project(&kernels[i]);
+		check_slide_amdf(&kernels[i]);
+	}
+	return failures ? 1 : 0;
+}
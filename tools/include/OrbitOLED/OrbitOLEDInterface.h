@@ -0,0 +1,22 @@
+/*
+ * File: OrbitOLEDInterface.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the OrbitOLED library interface. Only the functions used
+ * by the fitness monitor are declared; they are implemented by oled_mock.c so
+ * display code can be built and run on Linux.
+ */
+
+#ifndef ORBIT_OLED_INTERFACE_H
+#define ORBIT_OLED_INTERFACE_H
+
+#include <stdint.h>
+
+void OLEDInitialise(void);
+
+void OLEDStringDraw(char *pcStr, uint32_t ulColumn, uint32_t ulRow);
+
+#endif /* ORBIT_OLED_INTERFACE_H */
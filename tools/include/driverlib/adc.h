@@ -0,0 +1,35 @@
+/*
+ * File: adc.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare ADC API. Implemented by tiva_stub.c.
+ */
+
+#ifndef ADC_H
+#define ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ADC_TRIGGER_PROCESSOR 0x00000000
+#define ADC_CTL_CH0           0x00000000
+#define ADC_CTL_IE            0x00000040
+#define ADC_CTL_END           0x00000020
+
+void ADCSequenceConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		uint32_t ui32Trigger, uint32_t ui32Priority);
+void ADCSequenceStepConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		uint32_t ui32Step, uint32_t ui32Config);
+void ADCSequenceEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+int32_t ADCSequenceDataGet(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		uint32_t *pui32Buffer);
+void ADCProcessorTrigger(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntRegister(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		void (*pfnHandler)(void));
+void ADCIntEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntClear(uint32_t ui32Base, uint32_t ui32SequenceNum);
+
+#endif /* ADC_H */
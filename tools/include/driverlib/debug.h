@@ -0,0 +1,16 @@
+/*
+ * File: debug.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare driverlib debug header used by ustdlib.c.
+ */
+
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#define ASSERT(expr)
+
+#endif /* DEBUG_H */
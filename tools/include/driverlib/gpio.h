@@ -0,0 +1,50 @@
+/*
+ * File: gpio.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare GPIO API. Implemented by tiva_stub.c.
+ */
+
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPIO_PIN_0 0x00000001
+#define GPIO_PIN_1 0x00000002
+#define GPIO_PIN_2 0x00000004
+#define GPIO_PIN_3 0x00000008
+#define GPIO_PIN_4 0x00000010
+#define GPIO_PIN_5 0x00000020
+#define GPIO_PIN_6 0x00000040
+#define GPIO_PIN_7 0x00000080
+
+#define GPIO_STRENGTH_2MA     0x00000001
+#define GPIO_PIN_TYPE_STD     0x00000008
+#define GPIO_PIN_TYPE_STD_WPU 0x0000000A
+#define GPIO_PIN_TYPE_STD_WPD 0x0000000C
+
+#define GPIO_FALLING_EDGE 0x00000000
+#define GPIO_RISING_EDGE  0x00000004
+#define GPIO_BOTH_EDGES   0x00000001
+#define GPIO_LOW_LEVEL    0x00000002
+#define GPIO_HIGH_LEVEL   0x00000006
+
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeI2C(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeI2CSCL(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinConfigure(uint32_t ui32PinConfig);
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32Strength,
+		uint32_t ui32PadType);
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOIntRegister(uint32_t ui32Port, void (*pfnIntHandler)(void));
+void GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType);
+void GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags);
+void GPIOIntDisable(uint32_t ui32Port, uint32_t ui32IntFlags);
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags);
+
+#endif /* GPIO_H */
@@ -0,0 +1,35 @@
+/*
+ * File: i2c.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare I2C master API. Implemented by tiva_stub.c,
+ * which passes register reads and writes on to the simulated ADXL345.
+ */
+
+#ifndef I2C_H
+#define I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define I2C_MASTER_CMD_SINGLE_SEND           0x00000007
+#define I2C_MASTER_CMD_SINGLE_RECEIVE        0x00000007
+#define I2C_MASTER_CMD_BURST_SEND_START      0x00000003
+#define I2C_MASTER_CMD_BURST_SEND_CONT       0x00000001
+#define I2C_MASTER_CMD_BURST_SEND_FINISH     0x00000005
+#define I2C_MASTER_CMD_BURST_RECEIVE_START   0x0000000b
+#define I2C_MASTER_CMD_BURST_RECEIVE_CONT    0x00000009
+#define I2C_MASTER_CMD_BURST_RECEIVE_FINISH  0x00000005
+
+void I2CMasterInitExpClk(uint32_t ui32Base, uint32_t ui32I2CClk, bool bFast);
+void I2CMasterSlaveAddrSet(uint32_t ui32Base, uint8_t ui8SlaveAddr, bool bReceive);
+void I2CMasterDataPut(uint32_t ui32Base, uint8_t ui8Data);
+uint32_t I2CMasterDataGet(uint32_t ui32Base);
+void I2CMasterControl(uint32_t ui32Base, uint32_t ui32Cmd);
+bool I2CMasterBusy(uint32_t ui32Base);
+bool I2CMasterBusBusy(uint32_t ui32Base);
+
+#endif /* I2C_H */
@@ -0,0 +1,20 @@
+/*
+ * File: interrupt.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare interrupt controller API. Implemented by tiva_stub.c.
+ */
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool IntMasterEnable(void);
+bool IntMasterDisable(void);
+
+#endif /* INTERRUPT_H */
@@ -0,0 +1,20 @@
+/*
+ * File: pin_map.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare pin map definitions used by the firmware.
+ */
+
+#ifndef PIN_MAP_H
+#define PIN_MAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPIO_PB2_I2C0SCL 0x00010803
+#define GPIO_PB3_I2C0SDA 0x00010C03
+
+#endif /* PIN_MAP_H */
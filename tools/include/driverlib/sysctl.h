@@ -0,0 +1,44 @@
+/*
+ * File: sysctl.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare system control API. Implemented by tiva_stub.c.
+ */
+
+#ifndef SYSCTL_H
+#define SYSCTL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SYSCTL_PERIPH_ADC0  0xf0003800
+#define SYSCTL_PERIPH_GPIOA 0xf0000800
+#define SYSCTL_PERIPH_GPIOB 0xf0000801
+#define SYSCTL_PERIPH_GPIOD 0xf0000803
+#define SYSCTL_PERIPH_GPIOE 0xf0000804
+#define SYSCTL_PERIPH_GPIOF 0xf0000805
+#define SYSCTL_PERIPH_I2C0  0xf0002000
+#define SYSCTL_PERIPH_WTIMER0 0xf0005c00
+
+#define SYSCTL_SYSDIV_10    0x04C00000
+#define SYSCTL_USE_PLL      0x00000000
+#define SYSCTL_OSC_MAIN     0x00000000
+#define SYSCTL_XTAL_16MHZ   0x00000540
+
+#define SYSCTL_DSLP_DIV_1   0x00000000
+#define SYSCTL_DSLP_OSC_INT 0x00000030
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+void SysCtlPeripheralReset(uint32_t ui32Peripheral);
+void SysCtlClockSet(uint32_t ui32Config);
+uint32_t SysCtlClockGet(void);
+void SysCtlDelay(uint32_t ui32Count);
+void SysCtlPeripheralDeepSleepEnable(uint32_t ui32Peripheral);
+void SysCtlPeripheralClockGating(bool bEnable);
+void SysCtlDeepSleepClockSet(uint32_t ui32Config);
+void SysCtlDeepSleep(void);
+
+#endif /* SYSCTL_H */
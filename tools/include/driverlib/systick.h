@@ -0,0 +1,20 @@
+/*
+ * File: systick.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare SysTick API. Implemented by tiva_stub.c.
+ */
+
+#ifndef SYSTICK_H
+#define SYSTICK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void SysTickIntEnable(void);
+void SysTickIntDisable(void);
+
+#endif /* SYSTICK_H */
@@ -0,0 +1,28 @@
+/*
+ * File: timer.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare general purpose timer API. Implemented by tiva_stub.c.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_CFG_PERIODIC 0x00000022
+#define TIMER_A            0x000000FF
+#define TIMER_CLOCK_SYSTEM 0x00000000
+#define TIMER_CLOCK_PIOSC  0x00000001
+
+void TimerClockSourceSet(uint32_t ui32Base, uint32_t ui32Source);
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config);
+void TimerLoadSet64(uint32_t ui32Base, uint64_t ui64Value);
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer);
+uint64_t TimerValueGet64(uint32_t ui32Base);
+
+#endif /* TIMER_H */
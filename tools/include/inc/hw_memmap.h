@@ -0,0 +1,26 @@
+/*
+ * File: hw_memmap.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare peripheral base addresses used by the firmware.
+ */
+
+#ifndef HW_MEMMAP_H
+#define HW_MEMMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPIO_PORTA_BASE 0x40004000
+#define GPIO_PORTB_BASE 0x40005000
+#define GPIO_PORTD_BASE 0x40007000
+#define GPIO_PORTE_BASE 0x40024000
+#define GPIO_PORTF_BASE 0x40025000
+#define I2C0_BASE       0x40020000
+#define ADC0_BASE       0x40038000
+#define WTIMER0_BASE    0x40036000
+
+#endif /* HW_MEMMAP_H */
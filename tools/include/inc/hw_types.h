@@ -0,0 +1,19 @@
+/*
+ * File: hw_types.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host replacement for the TivaWare hardware types header.
+ */
+
+#ifndef HW_TYPES_H
+#define HW_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HWREG(x) (*((volatile uint32_t *)(x)))
+
+#endif /* HW_TYPES_H */
@@ -0,0 +1,11 @@
+/*
+ * File: ustdlib.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host redirect to the copy of the TivaWare ustdlib header kept in the project root.
+ */
+
+#include "../../../ustdlib.h"
@@ -0,0 +1,111 @@
+/*
+ * File: oled_mock.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host mock of the Orbit OLED display. Records every draw call with a timestamp
+ * and keeps a copy of the 16x4 character frame so display code can be checked
+ * and timed on Linux.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "OrbitOLED/OrbitOLEDInterface.h"
+#include "oled_mock.h"
+
+static char frame[OLED_MOCK_ROWS][OLED_MOCK_COLS + 1];
+static oled_draw_t draw_log[OLED_MOCK_LOG_SIZE];
+static uint32_t log_count;
+static oled_mock_stats_t stats;
+static uint32_t char_cost_ns;
+static uint64_t start_ns;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Busy waits to stand in for the SPI transfer of the real display. */
+static void simulate_transfer(uint32_t chars) {
+	uint64_t until = now_ns() + (uint64_t) chars * char_cost_ns;
+	while (char_cost_ns > 0 && now_ns() < until) {
+	}
+}
+
+/* Clears the frame, the draw log and the statistics. */
+void oled_mock_reset(void) {
+	uint8_t row;
+	for (row = 0; row < OLED_MOCK_ROWS; row++) {
+		memset(frame[row], ' ', OLED_MOCK_COLS);
+		frame[row][OLED_MOCK_COLS] = '\0';
+	}
+	log_count = 0;
+	memset(&stats, 0, sizeof(stats));
+	start_ns = now_ns();
+}
+
+/* Simulated cost of sending one character to the display. */
+void oled_mock_set_char_cost_ns(uint32_t cost_ns) {
+	char_cost_ns = cost_ns;
+}
+
+void OLEDInitialise(void) {
+	oled_mock_reset();
+}
+
+void OLEDStringDraw(char *pcStr, uint32_t ulColumn, uint32_t ulRow) {
+	uint64_t begin = now_ns();
+	uint32_t len = 0;
+	if (ulRow < OLED_MOCK_ROWS) {
+		while (pcStr[len] != '\0' && ulColumn + len < OLED_MOCK_COLS) {
+			frame[ulRow][ulColumn + len] = pcStr[len];
+			len++;
+		}
+	}
+	if (log_count < OLED_MOCK_LOG_SIZE) {
+		oled_draw_t *entry = &draw_log[log_count++];
+		entry->time_ns = begin - start_ns;
+		entry->row = ulRow;
+		entry->col = ulColumn;
+		entry->len = len;
+		memcpy(entry->text, pcStr, len);
+		entry->text[len] = '\0';
+	}
+	simulate_transfer(len);
+	stats.draw_calls++;
+	stats.chars_drawn += len;
+	stats.busy_ns += now_ns() - begin;
+}
+
+/* Returns the text currently shown on a row. */
+const char *oled_mock_row(uint8_t row) {
+	return row < OLED_MOCK_ROWS ? frame[row] : "";
+}
+
+/* Returns the number of logged draw calls and a pointer to the log. */
+uint32_t oled_mock_log(const oled_draw_t **log) {
+	*log = draw_log;
+	return log_count;
+}
+
+/* Returns the draw statistics since the last reset. */
+oled_mock_stats_t oled_mock_stats(void) {
+	return stats;
+}
+
+/* Prints the current frame surrounded by a border. */
+void oled_mock_print_frame(FILE *out) {
+	uint8_t row;
+	fprintf(out, "+----------------+\n");
+	for (row = 0; row < OLED_MOCK_ROWS; row++) {
+		fprintf(out, "|%s|\n", frame[row]);
+	}
+	fprintf(out, "+----------------+\n");
+}
@@ -0,0 +1,58 @@
+/*
+ * File: oled_mock.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host mock of the Orbit OLED display. Records every draw call with a timestamp
+ * and keeps a copy of the 16x4 character frame so display code can be checked
+ * and timed on Linux.
+ */
+
+#ifndef OLED_MOCK_H
+#define OLED_MOCK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define OLED_MOCK_ROWS 4
+#define OLED_MOCK_COLS 16
+
+/* Maximum number of draw calls kept in the log, later calls are only counted. */
+#define OLED_MOCK_LOG_SIZE 4096
+
+typedef struct {
+	uint64_t time_ns;  /* Time of the call since oled_mock_reset. */
+	uint8_t row;
+	uint8_t col;
+	uint8_t len;
+	char text[OLED_MOCK_COLS + 1];
+} oled_draw_t;
+
+typedef struct {
+	uint32_t draw_calls;  /* Number of OLEDStringDraw calls. */
+	uint32_t chars_drawn; /* Characters sent to the display. */
+	uint64_t busy_ns;     /* Time spent inside the mock, including the simulated transfer. */
+} oled_mock_stats_t;
+
+/* Clears the frame, the draw log and the statistics. */
+void oled_mock_reset(void);
+
+/* Simulated cost of sending one character to the display, defaults to 0.
+ * The real OLED takes roughly 100us per character over SPI. */
+void oled_mock_set_char_cost_ns(uint32_t cost_ns);
+
+/* Returns the text currently shown on a row, always OLED_MOCK_COLS characters. */
+const char *oled_mock_row(uint8_t row);
+
+/* Returns the number of logged draw calls and a pointer to the log. */
+uint32_t oled_mock_log(const oled_draw_t **log);
+
+/* Returns the draw statistics since the last reset. */
+oled_mock_stats_t oled_mock_stats(void);
+
+/* Prints the current frame surrounded by a border. */
+void oled_mock_print_frame(FILE *out);
+
+#endif /* OLED_MOCK_H */
@@ -0,0 +1,390 @@
+/*
+ * File: replay.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Replays recorded accelerometer traces through the firmware step detection on
+ * the host. The real accelerometer driver, detector and UI code are linked
+ * against the driverlib stubs, and each sample is served to the driver by the
+ * simulated ADXL345 before handle_step_event is run, as the main loop would.
+ * The simulated ADXL345 is fed the trace at the rate it is currently set to, and
+ * its interrupt is passed to the driver through the GPIO stub. As in the main
+ * loop, samples are only read while the monitor is active, and the power
+ * states are timed against the trace. Reports the steps counted against the
+ * steps in the trace, the samples read per hour of trace, the share of the
+ * trace spent in each power state, and the time taken per sample read and in
+ * all.
+ *
+ * With -d only the step detector is run, on every sample of the trace in large
+ * blocks as fast as it goes, as the firmware would count if it never slept.
+ * With -t the time into the trace of each step counted is printed too, from the
+ * sample of its peak. Traces can be CSV or binary trace files. With -d the blocks
+ * of a binary trace file go to the detector straight from its memory mapping.
+ * With -f the step detector runs with the given fixed threshold, in raw units,
+ * instead of the adaptive threshold, to compare the two; -f implies -d. Exits
+ * with 1 if any trace could not be replayed.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -funsigned-char -Itools/include -Itools -I. tools/replay.c \
+ *       tools/trace.c tools/trace_file.c tools/tiva_stub.c tools/adxl345_sim.c tools/oled_mock.c \
+ *       accelerometer.c i2c_driver.c circBufT.c ui.c display.c format.c units.c \
+ *       potentiometer.c running_stats.c biquad.c peak_detector.c cadence.c \
+ *       goertzel.c gait_gate.c motion_gate.c gravity.c step_detector.c dsp.c power.c \
+ *       -lm -o replay
+ * -funsigned-char matches the ARM compiler, which the driver relies on to combine
+ * the data register bytes.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "accelerometer.h"
+#include "step_detector.h"
+#include "ui.h"
+#include "power.h"
+#include "trace.h"
+#include "trace_file.h"
+#include "adxl345_sim.h"
+#include "tiva_stub.h"
+
+/* Samples per block the step detector is fed with -d. */
+#define REPLAY_BLOCK 4096
+
+/* Trace samples remembered for the samples most recently read by the firmware, to
+ * find the trace sample of a step's peak from its number in the detector. Steps
+ * are confirmed within seconds of their peak, well inside this. */
+#define REPLAY_PEAK_HISTORY 4096
+
+/* Options from the command line. */
+static bool detector_only = false;
+static int32_t fixed_threshold = 0;
+static bool print_steps = false;
+
+/* Sample of the peak of each step counted, kept while printing steps. */
+static uint32_t *step_samples;
+static uint32_t step_count;
+static uint32_t step_capacity;
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Finds the output data rate of the trace, returning false if the step detector
+ * has no coefficients for it. */
+static bool find_rate(uint32_t rate_hz, accl_rate *rate) {
+	accl_rate r;
+	for (r = 0; r < ACCL_RATE_COUNT; r++) {
+		if (accl_rate_hz(r) == rate_hz) {
+			*rate = r;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Records the peak of a step, if steps are being printed. Returns false and
+ * prints an error if there is no memory for it. */
+static bool add_step_sample(const char *path, uint32_t sample) {
+	if (!print_steps) {
+		return true;
+	}
+	if (step_count == step_capacity) {
+		uint32_t capacity = step_capacity ? step_capacity * 2 : 1024;
+		uint32_t *samples = realloc(step_samples, capacity * sizeof(*samples));
+		if (samples == NULL) {
+			fprintf(stderr, "%s: out of memory for the times of %u steps\n", path, capacity);
+			return false;
+		}
+		step_samples = samples;
+		step_capacity = capacity;
+	}
+	step_samples[step_count++] = sample;
+	return true;
+}
+
+/* Prints the time into the trace of each step recorded, and forgets them. */
+static void print_step_times(const char *path, const trace_t *trace) {
+	uint32_t i;
+	for (i = 0; i < step_count; i++) {
+		printf("%s: step %u at %.2fs\n", path, i + 1, (double) step_samples[i] / trace->rate_hz);
+	}
+	step_count = 0;
+}
+
+/* Prints the start of the results of a trace, the steps counted against those taken. */
+static void print_counted(const char *path, const trace_t *trace, uint32_t counted) {
+	printf("%s: %u samples, counted %u", path, trace->length, counted);
+	if (trace->steps >= 0) {
+		int32_t error = (int32_t) counted - trace->steps;
+		printf(", actual %d, error %+d", trace->steps, error);
+		if (trace->steps > 0) {
+			printf(" (%+.1f%%)", 100.0 * error / trace->steps);
+		}
+	}
+}
+
+/* Prints the end of the results of a trace, the time taken. */
+static void print_time(uint32_t samples, uint64_t elapsed) {
+	printf(", %.1f ns/sample, %.1f ms\n", samples ? (double) elapsed / samples : 0.0,
+			elapsed / 1e6);
+}
+
+/* Runs the step detector on count consecutive samples in blocks of REPLAY_BLOCK,
+ * adding the time taken to elapsed. The detector numbers the samples from the
+ * start of the trace, so the peaks it gives are trace samples. Returns false if
+ * the step times could not be recorded. */
+static bool detect_samples(const char *path, step_detector_t *detector, const int16_t *x,
+		const int16_t *y, const int16_t *z, uint32_t count, uint64_t *elapsed) {
+	static uint32_t peaks[REPLAY_BLOCK];
+	uint32_t i;
+	for (i = 0; i < count; i += REPLAY_BLOCK) {
+		uint32_t n = count - i < REPLAY_BLOCK ? count - i : REPLAY_BLOCK;
+		uint64_t start = now_ns();
+		uint16_t steps = push_step_block(detector, x + i, y + i, z + i, n, peaks,
+				print_steps ? REPLAY_BLOCK : 0);
+		*elapsed += now_ns() - start;
+		uint16_t j;
+		for (j = 0; j < steps && j < REPLAY_BLOCK; j++) {
+			if (!add_step_sample(path, peaks[j])) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* Prints the results of the step detector alone on a trace. The gate blocks are
+ * split into those the gait gate was open after, those with motion it rejected
+ * and those still, and the share of samples the step stages ran on is what is
+ * left of the detector's work after the gates. */
+static void print_detector(const char *path, const trace_t *trace,
+		const step_detector_t *detector, uint64_t elapsed) {
+	print_step_times(path, trace);
+	print_counted(path, trace, step_detector_count(detector));
+	if (fixed_threshold != 0) {
+		printf(", fixed threshold %d", fixed_threshold);
+	}
+	step_gate_stats_t gates = step_detector_gate_stats(detector);
+	double blocks = gates.blocks ? gates.blocks / 100.0 : 1.0;
+	printf(", gate blocks %.1f%% open %.1f%% rejected %.1f%% still, detected %.1f%%",
+			gates.open_blocks / blocks, gates.rejected_blocks / blocks,
+			(gates.blocks - gates.open_blocks - gates.rejected_blocks) / blocks,
+			trace->length ? 100.0 * gates.detected / trace->length : 0.0);
+	printf(", %.1f M samples/s", elapsed ? trace->length * 1e3 / elapsed : 0.0);
+	print_time(trace->length, elapsed);
+}
+
+/* Runs only the step detector on every sample of the trace. Returns false if the
+ * step times could not be recorded. */
+static bool replay_detector(const char *path, const trace_t *trace) {
+	step_detector_t detector;
+	vector3_t rest = { trace->x[0], trace->y[0], trace->z[0] };
+	init_step_detector(&detector, trace->rate_hz, rest);
+	set_step_threshold(&detector, fixed_threshold);
+	uint64_t elapsed = 0;
+	if (!detect_samples(path, &detector, trace->x, trace->y, trace->z, trace->length,
+			&elapsed)) {
+		step_count = 0;
+		return false;
+	}
+	print_detector(path, trace, &detector, elapsed);
+	return true;
+}
+
+/* Runs only the step detector on every sample of a binary trace file, passing it
+ * each block where it lies in the mapping, without loading the trace. Returns
+ * false if the file cannot be opened or replayed, or a block does not match its
+ * checksum. */
+static bool replay_detector_file(const char *path) {
+	trace_file_t file;
+	if (!open_trace_file(&file, path)) {
+		return false;
+	}
+	/* The trace without its samples, for the results. */
+	trace_t trace = { file.rate_hz, file.steps, file.length, NULL, NULL, NULL };
+	const int16_t *x;
+	const int16_t *y;
+	const int16_t *z;
+	if (!step_detector_supports_rate(file.rate_hz) || file.length == 0) {
+		fprintf(stderr, "%s: unsupported sample rate %uHz or no samples\n", path, file.rate_hz);
+		close_trace_file(&file);
+		return false;
+	}
+	trace_file_block(&file, 0, &x, &y, &z);
+	step_detector_t detector;
+	vector3_t rest = { x[0], y[0], z[0] };
+	init_step_detector(&detector, file.rate_hz, rest);
+	set_step_threshold(&detector, fixed_threshold);
+
+	uint64_t elapsed = 0;
+	uint32_t b;
+	for (b = 0; b < file.blocks; b++) {
+		uint32_t n = trace_file_block(&file, b, &x, &y, &z);
+		bool valid = check_trace_file_block(&file, b);
+		if (!valid) {
+			fprintf(stderr, "%s: block %u does not match its checksum\n", path, b);
+		}
+		if (!valid || !detect_samples(path, &detector, x, y, z, n, &elapsed)) {
+			step_count = 0;
+			close_trace_file(&file);
+			return false;
+		}
+	}
+	print_detector(path, &trace, &detector, elapsed);
+	close_trace_file(&file);
+	return true;
+}
+
+/* Records the peaks of the steps the last sample read confirmed, given the trace
+ * sample of each of the samples read before it. Returns false if they could not
+ * be recorded. */
+static bool add_firmware_steps(const char *path, const uint32_t *read_samples,
+		uint32_t samples) {
+	const uint32_t *peaks;
+	uint16_t count = get_step_peaks(&peaks);
+	uint16_t j;
+	for (j = 0; j < count; j++) {
+		/* A peak too old to be remembered is put at the latest sample read. */
+		uint32_t peak = samples - peaks[j] <= REPLAY_PEAK_HISTORY ? peaks[j] : samples - 1;
+		if (!add_step_sample(path, read_samples[peak % REPLAY_PEAK_HISTORY])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Runs the trace through the accelerometer driver and the main loop. Returns false
+ * if the step times could not be recorded. */
+static bool replay_firmware(const char *path, const trace_t *trace, accl_rate rate) {
+	/* The trace sample of each of the latest samples the firmware read, indexed by
+	 * the detector's number for it modulo REPLAY_PEAK_HISTORY. */
+	static uint32_t read_samples[REPLAY_PEAK_HISTORY];
+
+	/* The device powers on reading the start of the trace, which initAccl
+	 * calibrates against. */
+	adxl345_sim_reset();
+	tiva_stub_set_time(0);
+	adxl345_sim_set_sample(trace->x[0], trace->y[0], trace->z[0]);
+	initAccl();
+	configure_accl(ACCL_DEFAULT_RANGE, rate);
+	init_ui();
+	reset_distance();
+	init_power();
+
+	/* The trace rate is the selected rate, the idle rate divides into it. */
+	uint32_t samples = 0;
+	uint16_t counted = get_steps_counted();
+	uint64_t start = now_ns();
+	uint32_t i = 0;
+	while (i < trace->length) {
+		uint32_t period = trace->rate_hz / get_accl_sample_rate();
+		tiva_stub_set_time((uint64_t) i * 1000000 / trace->rate_hz);
+		adxl345_sim_set_sample(trace->x[i], trace->y[i], trace->z[i]);
+		tiva_stub_update_gpio();
+		handle_accl_events();
+		if (update_power() == POWER_ACTIVE) {
+			/* Every sample read is detected, so the detector numbers them as they
+			 * are counted here. */
+			read_samples[samples % REPLAY_PEAK_HISTORY] = i;
+			handle_step_event();
+			samples++;
+			/* The counter is 16 bits, so only the change is taken. */
+			uint16_t steps = get_steps_counted() - counted;
+			if (steps != 0) {
+				if (!add_firmware_steps(path, read_samples, samples)) {
+					step_count = 0;
+					return false;
+				}
+				counted += steps;
+			}
+		}
+		i += period;
+	}
+	uint64_t elapsed = now_ns() - start;
+	tiva_stub_set_time((uint64_t) trace->length * 1000000 / trace->rate_hz);
+	uint64_t length_ms = (uint64_t) trace->length * 1000 / trace->rate_hz;
+
+	double hours = (double) trace->length / trace->rate_hz / 3600;
+	print_step_times(path, trace);
+	print_counted(path, trace, get_steps_counted());
+	printf(", %.0f samples/hour", hours > 0 ? samples / hours : 0.0);
+	const char *state_names[POWER_STATE_COUNT] = { "active", "idle", "sleep" };
+	power_state s;
+	for (s = 0; s < POWER_STATE_COUNT; s++) {
+		printf(", %.1f%% %s", length_ms ? 100.0 * get_power_state_ms(s) / length_ms : 0.0,
+				state_names[s]);
+	}
+	print_time(samples, elapsed);
+	return true;
+}
+
+/* Replays a trace. Returns false if it could not be loaded or replayed. */
+static bool replay(const char *path) {
+	if (detector_only && is_trace_file(path)) {
+		return replay_detector_file(path);
+	}
+	trace_t trace;
+	if (!load_trace(&trace, path)) {
+		return false;
+	}
+	accl_rate rate;
+	if (!find_rate(trace.rate_hz, &rate) || trace.length == 0) {
+		fprintf(stderr, "%s: unsupported sample rate %uHz or no samples\n", path, trace.rate_hz);
+		free_trace(&trace);
+		return false;
+	}
+	bool ok;
+	if (detector_only) {
+		ok = replay_detector(path, &trace);
+	} else {
+		ok = replay_firmware(path, &trace, rate);
+	}
+	free_trace(&trace);
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	int opt;
+	while ((opt = getopt(argc, argv, "dtf:")) != -1) {
+		switch (opt) {
+		case 'd':
+			detector_only = true;
+			break;
+		case 'f':
+			/* The firmware's detector is inside the driver, so only -d can fix it. */
+			fixed_threshold = atoi(optarg);
+			detector_only = true;
+			break;
+		case 't':
+			print_steps = true;
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+	if (optind >= argc) {
+		fprintf(stderr, "usage: replay [-d] [-t] [-f threshold] trace...\n"
+				"  -d  run only the step detector, on every sample\n"
+				"  -f  run only the step detector, with a fixed threshold in raw units\n"
+				"  -t  print the time of each step\n");
+		return 1;
+	}
+	bool ok = true;
+	int i;
+	for (i = optind; i < argc; i++) {
+		ok = replay(argv[i]) && ok;
+	}
+	free(step_samples);
+	return ok ? 0 : 1;
+}
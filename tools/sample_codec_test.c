@@ -0,0 +1,302 @@
+/*
+ * File: sample_codec_test.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Checks sample_codec.c on random and extreme blocks:
+ *   - random blocks round trip through the encoder and the C decoder, and the
+ *     AVX2 decoder when built with -mavx2. They are made from residuals of every
+ *     bit width under each prediction, and the encoder must have picked every
+ *     width and prediction it can: the previous reading at 0 to 16 bits, the
+ *     line, which is only picked when it needs fewer bits, at 1 to 15,
+ *   - blocks at the extremes of int16 round trip, including residuals that wrap
+ *     around 16 bits and the residual -32768, which needs all 16,
+ *   - random packed blocks with every valid header, including those the encoder
+ *     never writes, decode the same as a reference unpacking one bit at a time,
+ *   - headers that are not valid are refused without writing any readings.
+ * Prints the first few mismatches of each check and exits with 1 if any fail.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -I. tools/sample_codec_test.c sample_codec.c -o sample_codec_test
+ * and add -mavx2 to check the AVX2 decoder too.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sample_codec.h"
+
+/* Random blocks round tripped at each bit width under each prediction. */
+#define ROUND_TRIPS 6000
+
+/* Random packed blocks decoded per valid header. */
+#define DECODES 200
+
+/* Fills readings before decoding so missing writes are noticed. */
+#define GUARD 0x5A5A
+
+/* Mismatches printed per check. */
+#define MAX_REPORTED 5
+
+typedef uint16_t (*decode_fn)(const uint8_t *, int16_t *);
+
+typedef struct {
+	const char *name;
+	decode_fn decode;
+} decoder_t;
+
+static const decoder_t decoders[] = {
+	{ "c", decode_sample_block_c },
+#if defined(__AVX2__)
+	{ "avx2", decode_sample_block_avx2 },
+#endif
+};
+
+#define DECODER_COUNT (sizeof(decoders) / sizeof(decoders[0]))
+
+static uint32_t failures;
+static uint32_t seed = 1;
+
+/* xorshift32, the same blocks every run. */
+static uint32_t random_u32(void) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* Counts a mismatch, printing the first few of a check. */
+static void report(uint32_t *mismatches, const char *what, const char *decoder, uint32_t block,
+		uint16_t index, int32_t got, int32_t expected) {
+	if (*mismatches < MAX_REPORTED) {
+		printf("  %s %s block %u at %u: %d, expected %d\n", what, decoder, block, index, got,
+				expected);
+	}
+	(*mismatches)++;
+}
+
+/* Prints the result of a check and adds its mismatches to the failures. */
+static void finish(const char *check, uint32_t mismatches, uint32_t checked) {
+	printf("%s: %s, %u blocks, %u wrong\n", check, mismatches ? "FAIL" : "ok", checked,
+			mismatches);
+	failures += mismatches;
+}
+
+/* Decodes a block with every decoder and checks each gives the expected
+ * readings and size. */
+static void check_decoders(uint32_t *mismatches, const char *what, uint32_t block,
+		const uint8_t *packed, const int16_t *expected, uint16_t size) {
+	uint8_t d;
+	for (d = 0; d < DECODER_COUNT; d++) {
+		int16_t readings[SAMPLE_CODEC_BLOCK];
+		uint16_t i;
+		for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+			readings[i] = (int16_t) GUARD;
+		}
+		uint16_t got_size = decoders[d].decode(packed, readings);
+		if (got_size != size) {
+			report(mismatches, what, decoders[d].name, block, 0, got_size, size);
+			continue;
+		}
+		for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+			if (readings[i] != expected[i]) {
+				report(mismatches, what, decoders[d].name, block, i, readings[i], expected[i]);
+				break;
+			}
+		}
+	}
+}
+
+/* Encodes a block and checks it decodes to the same readings. Returns the header
+ * the encoder wrote, bits in the low byte and prediction in the high. */
+static uint16_t round_trip(uint32_t *mismatches, const char *what, uint32_t block,
+		const int16_t *readings, int16_t previous) {
+	uint8_t packed[SAMPLE_CODEC_MAX_BYTES];
+	uint16_t size = encode_sample_block(readings, previous, packed);
+	if (sample_block_size(packed) != size) {
+		report(mismatches, what, "sample_block_size", block, 0, sample_block_size(packed), size);
+	}
+	check_decoders(mismatches, what, block, packed, readings, size);
+	return packed[0] | packed[1] << 8;
+}
+
+/* Makes a block from random zigzag codes below 2^bits, at least one of them with
+ * the top bit set, as residuals against the prediction. */
+static int16_t make_block(int16_t *readings, uint8_t bits, uint8_t prediction) {
+	int16_t previous = (int16_t) random_u32();
+	uint16_t last = previous;
+	uint16_t change = 0;
+	uint16_t top = bits ? random_u32() % SAMPLE_CODEC_BLOCK : 0;
+	uint16_t i;
+	for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+		uint16_t code = bits ? (uint16_t) (random_u32() & ((1u << bits) - 1)) : 0;
+		if (bits && i == top) {
+			code |= 1u << (bits - 1);
+		}
+		uint16_t residual = (code >> 1) ^ (uint16_t) -(code & 1);
+		uint16_t next_change = prediction == SAMPLE_CODEC_LINEAR ? change + residual : residual;
+		last += next_change;
+		change = next_change;
+		readings[i] = (int16_t) last;
+	}
+	return previous;
+}
+
+static void check_random(void) {
+	bool seen[17][3] = { { false } };
+	int16_t readings[SAMPLE_CODEC_BLOCK];
+	uint32_t mismatches = 0;
+	uint32_t checked = 0;
+	uint8_t prediction;
+	seed = 1;
+	for (prediction = SAMPLE_CODEC_PREVIOUS; prediction <= SAMPLE_CODEC_LINEAR; prediction++) {
+		uint8_t bits;
+		for (bits = 0; bits <= 16; bits++) {
+			uint32_t n;
+			for (n = 0; n < ROUND_TRIPS; n++) {
+				int16_t previous = make_block(readings, bits, prediction);
+				uint16_t header = round_trip(&mismatches, "round trip", checked, readings,
+						previous);
+				seen[header & 0xFF][header >> 8] = true;
+				checked++;
+			}
+		}
+	}
+	uint8_t bits;
+	for (bits = 0; bits <= 16; bits++) {
+		if (!seen[bits][SAMPLE_CODEC_PREVIOUS]) {
+			printf("  previous at %u bits never encoded\n", bits);
+			mismatches++;
+		}
+		if (bits >= 1 && bits <= 15 && !seen[bits][SAMPLE_CODEC_LINEAR]) {
+			printf("  linear at %u bits never encoded\n", bits);
+			mismatches++;
+		}
+	}
+	finish("random round trip", mismatches, checked);
+}
+
+/* Blocks at the extremes of int16: constant, alternating between them so
+ * residuals wrap, steps of -32768 and ramps of the largest steps, each from
+ * every extreme as the reading before. */
+static void check_extremes(void) {
+	static const int16_t values[] = { INT16_MIN, INT16_MAX, -1, 0, 1 };
+	const uint8_t value_count = sizeof(values) / sizeof(values[0]);
+	int16_t readings[SAMPLE_CODEC_BLOCK];
+	uint32_t mismatches = 0;
+	uint32_t checked = 0;
+	uint8_t a;
+	uint8_t b;
+	uint8_t p;
+	for (a = 0; a < value_count; a++) {
+		for (b = 0; b < value_count; b++) {
+			for (p = 0; p < value_count; p++) {
+				uint16_t i;
+				/* Alternating, constant when a and b are the same. */
+				for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+					readings[i] = i % 2 ? values[a] : values[b];
+				}
+				round_trip(&mismatches, "alternating", checked++, readings, values[p]);
+				/* Stepping by a - b, which wraps, from a. */
+				for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+					readings[i] = (int16_t) (uint16_t) (values[a]
+							+ i * (uint16_t) (values[a] - values[b]));
+				}
+				round_trip(&mismatches, "ramp", checked++, readings, values[p]);
+				/* Steps of -32768 among readings of a. */
+				for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+					readings[i] = (int16_t) (uint16_t) (values[a] + (i % 3 == 1 ? 0x8000 : 0));
+				}
+				round_trip(&mismatches, "half steps", checked++, readings, values[p]);
+			}
+		}
+	}
+	finish("extremes round trip", mismatches, checked);
+}
+
+/* Unpacks a block one bit at a time from the layout in sample_codec.h. */
+static void reference_decode(const uint8_t *packed, int16_t *readings) {
+	uint8_t bits = packed[0];
+	const uint8_t *words = packed + SAMPLE_CODEC_HEADER;
+	uint16_t last = packed[2] | packed[3] << 8;
+	uint16_t change = 0;
+	uint16_t i;
+	for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+		uint16_t lane = i % SAMPLE_CODEC_LANES;
+		uint32_t first_bit = (i / SAMPLE_CODEC_LANES) * bits;
+		uint16_t code = 0;
+		uint8_t bit;
+		for (bit = 0; bit < bits; bit++) {
+			uint32_t lane_bit = first_bit + bit;
+			uint32_t word = (lane_bit / 16) * SAMPLE_CODEC_LANES + lane;
+			uint16_t value = words[2 * word] | words[2 * word + 1] << 8;
+			code |= ((value >> (lane_bit % 16)) & 1) << bit;
+		}
+		uint16_t residual = (code >> 1) ^ (uint16_t) -(code & 1);
+		if (packed[1] == SAMPLE_CODEC_LINEAR) {
+			change += residual;
+			last += change;
+		} else {
+			last += residual;
+		}
+		readings[i] = (int16_t) last;
+	}
+}
+
+static void check_headers(void) {
+	uint8_t packed[SAMPLE_CODEC_MAX_BYTES];
+	int16_t expected[SAMPLE_CODEC_BLOCK];
+	uint32_t mismatches = 0;
+	uint32_t checked = 0;
+	uint8_t prediction;
+	seed = 3;
+	for (prediction = SAMPLE_CODEC_PREVIOUS; prediction <= SAMPLE_CODEC_LINEAR; prediction++) {
+		uint8_t bits;
+		for (bits = 0; bits <= 16; bits++) {
+			uint32_t n;
+			for (n = 0; n < DECODES; n++) {
+				uint16_t i;
+				for (i = 0; i < SAMPLE_CODEC_MAX_BYTES; i++) {
+					packed[i] = (uint8_t) random_u32();
+				}
+				packed[0] = bits;
+				packed[1] = prediction;
+				reference_decode(packed, expected);
+				check_decoders(&mismatches, "header", checked, packed, expected,
+						SAMPLE_CODEC_HEADER + bits * SAMPLE_CODEC_LANES * 2);
+				checked++;
+			}
+		}
+	}
+	/* Too many bits, or a prediction that does not exist. */
+	static const uint8_t invalid[][2] = { { 17, SAMPLE_CODEC_PREVIOUS }, { 255, SAMPLE_CODEC_LINEAR },
+			{ 8, 0 }, { 8, 3 }, { 0, 255 } };
+	uint8_t h;
+	for (h = 0; h < sizeof(invalid) / sizeof(invalid[0]); h++) {
+		uint16_t i;
+		memset(packed, 0, sizeof(packed));
+		packed[0] = invalid[h][0];
+		packed[1] = invalid[h][1];
+		for (i = 0; i < SAMPLE_CODEC_BLOCK; i++) {
+			expected[i] = (int16_t) GUARD;
+		}
+		if (sample_block_size(packed) != 0) {
+			report(&mismatches, "invalid header", "sample_block_size", checked, 0,
+					sample_block_size(packed), 0);
+		}
+		check_decoders(&mismatches, "invalid header", checked, packed, expected, 0);
+		checked++;
+	}
+	finish("headers", mismatches, checked);
+}
+
+int main(void) {
+	check_random();
+	check_extremes();
+	check_headers();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,401 @@
+/*
+ * File: step_lanes.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Step detection on many recordings at once on the host, in lockstep across
+ * STEP_LANES lanes. Every stage follows its counterpart in the firmware exactly,
+ * but a lane's update is kept or dropped by a select rather than an if, so all
+ * the lanes step forward together. Only the rare events, a step, a decimated
+ * sample of the cadence, a renewal of gravity or the end of a gate block, are
+ * handled one lane at a time.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "accelerometer.h"
+#include "units.h"
+#include "step_lanes.h"
+
+/* Vectors are only returned from the static functions here, so the warning that
+ * their calling convention depends on the instruction set does not matter. They
+ * are passed in by pointer, or to macros, as GCC notes any passed by value. */
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef uint32_t lanes_uint_t __attribute__((vector_size(4 * STEP_LANES)));
+typedef int64_t lanes_wide_t __attribute__((vector_size(8 * STEP_LANES)));
+typedef int16_t lanes_short_t __attribute__((vector_size(2 * STEP_LANES)));
+
+/* Returns the value in every lane. */
+static lanes_int_t broadcast(int32_t value) {
+	lanes_int_t zero = { 0 };
+	return zero + value;
+}
+
+/* Each lane of a where the mask is set, otherwise of b. */
+#define SELECT_LANES(mask, a, b) (((a) & (mask)) | ((b) & ~(mask)))
+
+/* Returns true if the mask is set in any lane. */
+static bool any_lanes(const lanes_int_t *mask) {
+	uint8_t l;
+	for (l = 0; l < STEP_LANES; l++) {
+		if ((*mask)[l] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Returns a reading of every lane, from STEP_LANES consecutive int16. */
+static lanes_int_t load_readings(const int16_t *readings) {
+	lanes_short_t packed;
+	memcpy(&packed, readings, sizeof(packed));
+	return __builtin_convertvector(packed, lanes_int_t);
+}
+
+/* Products of every lane with a coefficient, in 64 bits. */
+#define MULTIPLY_WIDE(value, coef) (__builtin_convertvector(value, lanes_wide_t) * (int64_t) (coef))
+
+/* Rounds fixed point products of every lane back to 32 bits. */
+#define ROUND_WIDE(value, frac_bits) \
+	__builtin_convertvector(((value) + (1 << ((frac_bits) - 1))) >> (frac_bits), lanes_int_t)
+
+/* Loads the state of STEP_LANES detectors into the lanes. */
+bool load_step_lanes(step_lanes_t *lanes, const step_detector_t *detectors) {
+	const step_detector_t *first = &detectors[0];
+	uint8_t l;
+	uint8_t i;
+	for (l = 0; l < STEP_LANES; l++) {
+		const step_detector_t *detector = &detectors[l];
+		if (detector->rate != first->rate || detector->block_count != first->block_count
+				|| detector->gravity.count != first->gravity.count
+				|| !detector->filter_primed || detector->fixed_threshold != 0) {
+			return false;
+		}
+	}
+
+	lanes->gravity_count = first->gravity.count;
+	lanes->gravity_shift = first->gravity.shift;
+	lanes->highpass_coefs = *first->highpass.coefs;
+	lanes->lowpass_coefs = *first->lowpass.coefs;
+	lanes->stats_shift = first->stats.shift;
+	lanes->min_interval = first->peaks.min_interval;
+	lanes->max_interval = first->peaks.max_interval;
+	lanes->decimation = first->cadence.decimation;
+	lanes->motion_threshold = first->motion_gate.threshold;
+	lanes->motion_hold = first->motion_gate.hold;
+	for (i = 0; i < GAIT_GATE_BINS; i++) {
+		lanes->gait_coefs[i] = first->gait_gate.bins[i].coef;
+	}
+	lanes->gait_threshold = first->gait_gate.threshold;
+	lanes->block_length = first->block_length;
+	lanes->block_count = first->block_count;
+
+	for (l = 0; l < STEP_LANES; l++) {
+		const step_detector_t *detector = &detectors[l];
+		for (i = 0; i < 3; i++) {
+			lanes->gravity[i][l] = detector->gravity.gravity[i];
+			lanes->unit[i][l] = detector->gravity.unit[i];
+		}
+		lanes->highpass[0][l] = detector->highpass.x1;
+		lanes->highpass[1][l] = detector->highpass.x2;
+		lanes->highpass[2][l] = detector->highpass.y1;
+		lanes->highpass[3][l] = detector->highpass.y2;
+		lanes->lowpass[0][l] = detector->lowpass.x1;
+		lanes->lowpass[1][l] = detector->lowpass.x2;
+		lanes->lowpass[2][l] = detector->lowpass.y1;
+		lanes->lowpass[3][l] = detector->lowpass.y2;
+		lanes->mean[l] = detector->stats.mean;
+		lanes->variance[l] = detector->stats.variance;
+		lanes->previous[l] = detector->peaks.previous;
+		lanes->previous_above[l] = -(int32_t) detector->peaks.previous_above;
+		lanes->rising[l] = -(int32_t) detector->peaks.rising;
+		lanes->since_step[l] = detector->peaks.since_step;
+		lanes->interval[l] = detector->peaks.interval;
+		lanes->cadence[l] = detector->cadence;
+		lanes->decimation_sum[l] = detector->cadence.decimation_sum;
+		lanes->decimation_count[l] = detector->cadence.decimation_count;
+		lanes->period_interval[l] = (uint16_t) (cadence_period(&detector->cadence)
+				* lanes->decimation);
+		lanes->baseline[l] = detector->motion_gate.baseline;
+		lanes->remaining[l] = detector->motion_gate.remaining;
+		lanes->gait_hold[l] = detector->gait_gate.hold;
+		lanes->open[l] = -(int32_t) detector->gait_gate.open;
+		for (i = 0; i < detector->block_count; i++) {
+			lanes->block[i][l] = detector->block[i];
+		}
+		lanes->block_motion[l] = -(int32_t) detector->block_motion;
+		lanes->steps[l] = detector->steps;
+	}
+	return true;
+}
+
+/* Renews the unit vector of a lane from its average gravity, as gravity.c does. */
+static void renew_unit(step_lanes_t *lanes, uint8_t l) {
+	uint8_t i;
+	int32_t norm = gravity_norm(lanes->gravity[0][l], lanes->gravity[1][l],
+			lanes->gravity[2][l]);
+	if (norm < (GRAVITY_MIN_NORM << GRAVITY_FRAC_BITS)) {
+		return;
+	}
+	for (i = 0; i < 3; i++) {
+		lanes->unit[i][l] = (int64_t) lanes->gravity[i][l] * (1 << GRAVITY_UNIT_BITS) / norm;
+	}
+}
+
+/* Feeds count readings of every lane to gravity and the motion gate, writing
+ * their acceleration along gravity. The unit vectors are renewed at the same
+ * sample in every lane, as all lanes started their gravity blocks together. */
+static void update_gates_lanes(step_lanes_t *lanes, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint16_t count, lanes_int_t *vertical) {
+	uint8_t shift = lanes->gravity_shift;
+	lanes_int_t threshold = broadcast(lanes->motion_threshold);
+	lanes_int_t hold = broadcast(lanes->motion_hold);
+	uint16_t i;
+	uint8_t l;
+	for (i = 0; i < count; i++) {
+		lanes_int_t axes[3] = { load_readings(x), load_readings(y), load_readings(z) };
+		lanes_int_t value = (axes[0] * lanes->unit[0] + axes[1] * lanes->unit[1]
+				+ axes[2] * lanes->unit[2]) >> (GRAVITY_UNIT_BITS - GRAVITY_FRAC_BITS);
+		for (l = 0; l < 3; l++) {
+			lanes->gravity[l] += (axes[l] * (1 << GRAVITY_FRAC_BITS) - lanes->gravity[l]) >> shift;
+		}
+		vertical[i] = value;
+
+		lanes_int_t deviation = value - lanes->baseline;
+		lanes->baseline += deviation >> MOTION_BASELINE_SHIFT;
+		lanes_int_t moved = SELECT_LANES(deviation < 0, -deviation, deviation) > threshold;
+		lanes_int_t holding = lanes->remaining > 0;
+		lanes->block_motion |= moved | holding;
+		/* The holding flag is -1 where set, counting the hold down. */
+		lanes->remaining = SELECT_LANES(moved, hold, lanes->remaining + holding);
+
+		x += STEP_LANES;
+		y += STEP_LANES;
+		z += STEP_LANES;
+		lanes->gravity_count++;
+		if (lanes->gravity_count == GRAVITY_UNIT_BLOCK) {
+			lanes->gravity_count = 0;
+			for (l = 0; l < STEP_LANES; l++) {
+				renew_unit(lanes, l);
+			}
+		}
+	}
+}
+
+/* Filters one sample of every lane through a biquad section, as update_biquad,
+ * keeping the new state in the lanes that are on. */
+static lanes_int_t filter_lanes(const biquad_coefs_t *c, lanes_int_t *state,
+		const lanes_int_t *sample, const lanes_int_t *lanes_on) {
+	lanes_int_t input = *sample;
+	lanes_int_t on = *lanes_on;
+	lanes_wide_t acc = MULTIPLY_WIDE(input, c->b0);
+	acc += MULTIPLY_WIDE(state[0], c->b1);
+	acc += MULTIPLY_WIDE(state[1], c->b2);
+	acc -= MULTIPLY_WIDE(state[2], c->a1);
+	acc -= MULTIPLY_WIDE(state[3], c->a2);
+	lanes_int_t output = ROUND_WIDE(acc, BIQUAD_COEF_BITS);
+	state[1] = SELECT_LANES(on, state[0], state[1]);
+	state[0] = SELECT_LANES(on, input, state[0]);
+	state[3] = SELECT_LANES(on, state[2], state[3]);
+	state[2] = SELECT_LANES(on, output, state[2]);
+	return output;
+}
+
+/* Runs the step stages on count samples of vertical acceleration in the lanes
+ * that are on, as detect_step_vertical in step_detector.c does on each. */
+static void detect_steps_lanes(step_lanes_t *lanes, const lanes_int_t *vertical,
+		uint16_t count, const lanes_int_t *lanes_on) {
+	lanes_int_t on = *lanes_on;
+	uint8_t shift = lanes->stats_shift;
+	lanes_int_t min_interval = broadcast(lanes->min_interval);
+	lanes_int_t max_interval = broadcast(lanes->max_interval);
+	lanes_int_t decimation = broadcast(lanes->decimation);
+	uint16_t i;
+	uint8_t l;
+	for (i = 0; i < count; i++) {
+		lanes_int_t highpassed = filter_lanes(&lanes->highpass_coefs, lanes->highpass,
+				&vertical[i], &on);
+		lanes_int_t value = filter_lanes(&lanes->lowpass_coefs, lanes->lowpass,
+				&highpassed, &on) >> GRAVITY_FRAC_BITS;
+
+		/* The threshold, then the running statistics, as running_stats.c. */
+		lanes_int_t mean = lanes->mean;
+		lanes_int_t variance = lanes->variance;
+		lanes_int_t deviation = value - (mean >> RUNNING_STATS_FRAC_BITS);
+		lanes_int_t above = (deviation > MIN_STEP_THRESHOLD)
+				& (lanes_int_t) ((lanes_uint_t) (deviation * deviation) << (2 * STEP_THRESHOLD_DEVIATION_SHIFT)
+						> (lanes_uint_t) variance);
+		lanes_int_t scaled = value * (1 << RUNNING_STATS_FRAC_BITS);
+		lanes_int_t old_deviation = (scaled - mean) >> RUNNING_STATS_FRAC_BITS;
+		lanes_int_t new_mean = mean + ((scaled - mean) >> shift);
+		lanes_int_t new_deviation = (scaled - new_mean) >> RUNNING_STATS_FRAC_BITS;
+		lanes->mean = SELECT_LANES(on, new_mean, mean);
+		lanes->variance = SELECT_LANES(on,
+				variance + ((old_deviation * new_deviation - variance) >> shift), variance);
+
+		/* The peak picking, as peak_detector.c, with the refractory period 5/8 of
+		 * the smoothed interval and no shorter than the minimum. */
+		lanes_int_t since = lanes->since_step - (lanes->since_step < UINT16_MAX);
+		lanes_int_t interval = lanes->interval;
+		lanes_int_t refractory = (interval * 5) >> (PEAK_INTERVAL_FRAC_BITS + 3);
+		refractory = SELECT_LANES((interval == 0) | (refractory < min_interval),
+				min_interval, refractory);
+		lanes_int_t previous = lanes->previous;
+		lanes_int_t peak = lanes->rising & (value < previous) & lanes->previous_above
+				& (since > refractory);
+		lanes_int_t measured = (since - 1) << PEAK_INTERVAL_FRAC_BITS;
+		lanes_int_t smoothed = SELECT_LANES(interval == 0, measured,
+				interval + ((measured - interval) >> PEAK_INTERVAL_SHIFT));
+		interval = SELECT_LANES(peak & (since - 1 <= max_interval), smoothed, interval);
+		since = SELECT_LANES(peak, broadcast(1), since);
+		interval = SELECT_LANES(since > max_interval, broadcast(0), interval);
+		lanes->since_step = SELECT_LANES(on, since, lanes->since_step);
+		lanes->interval = SELECT_LANES(on, interval, lanes->interval);
+		lanes->rising = SELECT_LANES(on & (value != previous), value > previous, lanes->rising);
+		lanes->previous = SELECT_LANES(on, value, previous);
+		lanes->previous_above = SELECT_LANES(on, above, lanes->previous_above);
+
+		/* The cadence, as update_cadence. */
+		lanes_int_t step = peak & on;
+		lanes->decimation_sum = SELECT_LANES(on, lanes->decimation_sum + value,
+				lanes->decimation_sum);
+		lanes->decimation_count -= on;
+		lanes_int_t full = lanes->decimation_count == decimation;
+		lanes_int_t event = step | full;
+		if (any_lanes(&event)) {
+			for (l = 0; l < STEP_LANES; l++) {
+				cadence_t *cadence = &lanes->cadence[l];
+				if (step[l] != 0) {
+					add_cadence_step(cadence, 0);
+				}
+				if (full[l] != 0) {
+					push_cadence_sum(cadence, lanes->decimation_sum[l]);
+					lanes->decimation_sum[l] = 0;
+					lanes->decimation_count[l] = 0;
+					lanes->period_interval[l] = (uint16_t) (cadence_period(cadence)
+							* lanes->decimation);
+				}
+				lanes->steps[l] += cadence_take_steps(cadence, 0, 0);
+			}
+		}
+
+		/* The period of the repetition caps the smoothed interval, as limit_peak_interval. */
+		lanes->interval = SELECT_LANES(on & (lanes->period_interval != 0)
+				& (lanes->interval > lanes->period_interval),
+				lanes->period_interval, lanes->interval);
+	}
+}
+
+/* Starts the step stages of a lane afresh with its filters settled on a sample,
+ * as reset_step_stages and the first detect_step_vertical after it do. */
+static void reset_lane(step_lanes_t *lanes, uint8_t l, int32_t first) {
+	uint8_t i;
+	for (i = 0; i < 4; i++) {
+		lanes->highpass[i][l] = i < 2 ? first : 0;
+		lanes->lowpass[i][l] = 0;
+	}
+	lanes->mean[l] = 0;
+	lanes->variance[l] = 0;
+	lanes->previous[l] = 0;
+	lanes->previous_above[l] = 0;
+	lanes->rising[l] = 0;
+	lanes->since_step[l] = UINT16_MAX;
+	lanes->interval[l] = 0;
+	init_cadence(&lanes->cadence[l], lanes->decimation);
+	lanes->decimation_sum[l] = 0;
+	lanes->decimation_count[l] = 0;
+	lanes->period_interval[l] = 0;
+}
+
+/* Runs the gait gate of every lane on the finished gate block, as gait_gate.c.
+ * The bins are filtered in every lane if any has motion, and only count in those
+ * that do, the same as the gate skipping the block in the others. */
+static void end_gate_block_lanes(step_lanes_t *lanes) {
+	lanes_int_t s1[GAIT_GATE_BINS] = { { 0 } };
+	lanes_int_t s2[GAIT_GATE_BINS] = { { 0 } };
+	uint16_t n;
+	uint8_t b;
+	uint8_t l;
+	if (any_lanes(&lanes->block_motion)) {
+		for (n = 0; n < lanes->block_length; n++) {
+			lanes_int_t input = lanes->block[n] >> GAIT_GATE_INPUT_SHIFT;
+			for (b = 0; b < GAIT_GATE_BINS; b++) {
+				lanes_int_t s0 = input + ROUND_WIDE(MULTIPLY_WIDE(s1[b], lanes->gait_coefs[b]),
+						GOERTZEL_COEF_BITS) - s2[b];
+				s2[b] = s1[b];
+				s1[b] = s0;
+			}
+		}
+	}
+	for (l = 0; l < STEP_LANES; l++) {
+		bool gait = false;
+		for (b = 0; lanes->block_motion[l] != 0 && b < GAIT_GATE_BINS; b++) {
+			goertzel_t bin = { lanes->gait_coefs[b], s1[b][l], s2[b][l] };
+			if (end_goertzel_block(&bin) > lanes->gait_threshold) {
+				gait = true;
+			}
+		}
+		if (gait) {
+			lanes->open[l] = -1;
+			lanes->gait_hold[l] = GAIT_GATE_HOLD_BLOCKS;
+		} else if (lanes->gait_hold[l] > 0) {
+			lanes->gait_hold[l]--;
+		} else {
+			lanes->open[l] = 0;
+		}
+	}
+	lanes->block_motion = broadcast(0);
+}
+
+/* Detects steps in count samples of every lane, split where gate blocks end as
+ * push_step_block does. */
+void push_step_lanes(step_lanes_t *lanes, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint32_t count) {
+	uint32_t done = 0;
+	uint8_t l;
+	while (done < count) {
+		uint32_t n = lanes->block_length - lanes->block_count;
+		if (n > count - done) {
+			n = count - done;
+		}
+		lanes_int_t *vertical = &lanes->block[lanes->block_count];
+		update_gates_lanes(lanes, x + done * STEP_LANES, y + done * STEP_LANES,
+				z + done * STEP_LANES, n, vertical);
+		lanes->block_count += n;
+
+		/* The gates only change at the end of a gate block. */
+		lanes_int_t was_open = lanes->open;
+		if (any_lanes(&was_open)) {
+			detect_steps_lanes(lanes, vertical, n, &was_open);
+		}
+		done += n;
+		if (lanes->block_count < lanes->block_length) {
+			continue;
+		}
+
+		end_gate_block_lanes(lanes);
+		lanes->block_count = 0;
+
+		/* Catch up on the block in the lanes it opened, from fresh step stages. */
+		lanes_int_t opened = lanes->open & ~was_open;
+		if (any_lanes(&opened)) {
+			for (l = 0; l < STEP_LANES; l++) {
+				if (opened[l] != 0) {
+					reset_lane(lanes, l, lanes->block[0][l]);
+				}
+			}
+			detect_steps_lanes(lanes, lanes->block, lanes->block_length, &opened);
+		}
+	}
+}
+
+/* Returns the steps confirmed in a lane. */
+uint32_t step_lanes_count(const step_lanes_t *lanes, uint8_t lane) {
+	return lanes->steps[lane];
+}
@@ -0,0 +1,102 @@
+/*
+ * File: step_lanes.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Step detection on many recordings at once on the host. STEP_LANES detectors
+ * run in lockstep, one recording each, with every field of their state held in
+ * a vector across the lanes. Each stage then steps all the lanes forward with
+ * SIMD instructions, rather than working along one recording, where each sample
+ * depends on the one before. The counts are the same as step_detector.c gives on
+ * each recording alone. The vectors use the GCC vector extensions, which Clang
+ * also has, and compile to AVX2 or AVX-512 when enabled. Requires accelerometer.h
+ * to be included first.
+ */
+
+#ifndef STEP_LANES_H
+#define STEP_LANES_H
+
+#include "step_detector.h"
+
+/* Recordings run at once. 8 fills AVX2 with the 32 bit state, 16 fills AVX-512. */
+#ifndef STEP_LANES
+#define STEP_LANES 8
+#endif
+
+/* A 32 bit field of every lane. Flags are all ones when set and 0 when clear, as
+ * vector comparisons give them. */
+typedef int32_t lanes_int_t __attribute__((vector_size(4 * STEP_LANES)));
+
+typedef struct {
+	/* Average gravity and its unit vector, as gravity_t. */
+	lanes_int_t gravity[3];
+	lanes_int_t unit[3];
+	uint8_t gravity_count;
+	uint8_t gravity_shift;
+
+	/* Band pass filter sections, as biquad_t. */
+	biquad_coefs_t highpass_coefs;
+	biquad_coefs_t lowpass_coefs;
+	lanes_int_t highpass[4];  /* x1, x2, y1 and y2 of each section. */
+	lanes_int_t lowpass[4];
+
+	/* Threshold statistics, as running_stats_t. */
+	lanes_int_t mean;
+	lanes_int_t variance;
+	uint8_t stats_shift;
+
+	/* Peak picking, as peak_detector_t. */
+	lanes_int_t previous;
+	lanes_int_t previous_above;
+	lanes_int_t rising;
+	lanes_int_t since_step;
+	lanes_int_t interval;
+	uint16_t min_interval;
+	uint16_t max_interval;
+
+	/* The input samples of each decimated sample of the cadence are summed across
+	 * the lanes. The rest of the cadence runs one lane at a time, only on a step
+	 * or a decimated sample. */
+	cadence_t cadence[STEP_LANES];
+	lanes_int_t decimation_sum;
+	lanes_int_t decimation_count;
+	lanes_int_t period_interval;  /* Step period in samples with PEAK_INTERVAL_FRAC_BITS, 0 if not periodic. */
+	uint8_t decimation;
+
+	/* Motion and gait gates, as motion_gate_t and gait_gate_t. */
+	lanes_int_t baseline;
+	lanes_int_t remaining;
+	int32_t motion_threshold;
+	uint16_t motion_hold;
+	int32_t gait_coefs[GAIT_GATE_BINS];
+	uint64_t gait_threshold;
+	uint8_t gait_hold[STEP_LANES];
+	lanes_int_t open;
+
+	/* Vertical acceleration of the current gate block. */
+	lanes_int_t block[GAIT_GATE_BLOCK(STEP_DETECTOR_MAX_RATE_HZ)];
+	uint16_t block_length;
+	uint16_t block_count;
+	lanes_int_t block_motion;
+
+	/* Steps confirmed in each lane, carried on from the detectors loaded. */
+	uint32_t steps[STEP_LANES];
+} step_lanes_t;
+
+/* Loads the state of STEP_LANES detectors into the lanes, one each. The detectors
+ * must run at the same rate and be at the same point in their gate blocks, as
+ * they are after init_step_detector or the same number of samples since, and use
+ * the adaptive threshold. Returns false if they do not. */
+bool load_step_lanes(step_lanes_t *lanes, const step_detector_t *detectors);
+
+/* Detects steps in count samples of every lane, as push_step_block on each.
+ * Sample i of lane l is at index i * STEP_LANES + l of x, y and z. */
+void push_step_lanes(step_lanes_t *lanes, const int16_t *x, const int16_t *y,
+		const int16_t *z, uint32_t count);
+
+/* Returns the steps confirmed in a lane, including those of its detector when loaded. */
+uint32_t step_lanes_count(const step_lanes_t *lanes, uint8_t lane);
+
+#endif /* STEP_LANES_H */
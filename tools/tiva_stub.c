@@ -0,0 +1,357 @@
+/*
+ * File: tiva_stub.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Host implementation of the TivaWare driverlib functions used by the firmware.
+ * Peripheral setup does nothing, and I2C transfers are turned into register
+ * reads and writes on the simulated ADXL345 so the real accelerometer driver
+ * can run on Linux. The ADXL345 interrupt pins are wired to GPIO inputs whose
+ * registered interrupt handlers run on the selected edges. Time is set by the
+ * tool, and the timers count it from their selected clock. Sleeping returns at
+ * once, as the tool runs the hardware on between calls.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driverlib/sysctl.h"
+#include "driverlib/gpio.h"
+#include "driverlib/i2c.h"
+#include "driverlib/adc.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#include "inc/hw_memmap.h"
+#include "adxl345_sim.h"
+#include "tiva_stub.h"
+
+#define STUB_CLOCK_HZ 20000000
+#define STUB_PIOSC_HZ 16000000
+
+/* A GPIO input wired to an ADXL345 interrupt pin. */
+typedef struct {
+	uint32_t port;
+	uint8_t pin;
+	void (*handler)(void);
+	uint32_t type;
+	bool enabled;
+	bool level;
+} gpio_line_t;
+
+/* INT1 and INT2, in the order of adxl345_sim_int_pins, as wired on the Orbit BoosterPack. */
+static gpio_line_t accl_lines[] = {
+	{ GPIO_PORTB_BASE, GPIO_PIN_4, 0, GPIO_FALLING_EDGE, false, false },
+	{ GPIO_PORTE_BASE, GPIO_PIN_4, 0, GPIO_FALLING_EDGE, false, false }
+};
+
+#define ACCL_LINES (sizeof(accl_lines) / sizeof(accl_lines[0]))
+
+/* I2C state, the register pointer is set by the first byte of each transfer.
+ * Send and receive commands share values, so the direction set with the slave
+ * address decides what a command does. */
+static bool i2c_receive;
+static uint8_t i2c_put_data;
+static uint8_t i2c_get_data;
+static uint8_t i2c_register;
+
+/* Time since power on, and the clock and load of the only timer used. */
+static uint64_t time_us;
+static uint32_t timer_clock_hz = STUB_CLOCK_HZ;
+static uint64_t timer_load;
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral) {
+	(void) ui32Peripheral;
+}
+
+void SysCtlPeripheralReset(uint32_t ui32Peripheral) {
+	(void) ui32Peripheral;
+}
+
+void SysCtlClockSet(uint32_t ui32Config) {
+	(void) ui32Config;
+}
+
+uint32_t SysCtlClockGet(void) {
+	return STUB_CLOCK_HZ;
+}
+
+void SysCtlDelay(uint32_t ui32Count) {
+	(void) ui32Count;
+}
+
+void SysCtlPeripheralDeepSleepEnable(uint32_t ui32Peripheral) {
+	(void) ui32Peripheral;
+}
+
+void SysCtlPeripheralClockGating(bool bEnable) {
+	(void) bEnable;
+}
+
+void SysCtlDeepSleepClockSet(uint32_t ui32Config) {
+	(void) ui32Config;
+}
+
+void SysCtlDeepSleep(void) {
+}
+
+bool IntMasterEnable(void) {
+	return false;
+}
+
+bool IntMasterDisable(void) {
+	return false;
+}
+
+void SysTickIntEnable(void) {
+}
+
+void SysTickIntDisable(void) {
+}
+
+void TimerClockSourceSet(uint32_t ui32Base, uint32_t ui32Source) {
+	(void) ui32Base;
+	timer_clock_hz = ui32Source == TIMER_CLOCK_PIOSC ? STUB_PIOSC_HZ : STUB_CLOCK_HZ;
+}
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config) {
+	(void) ui32Base;
+	(void) ui32Config;
+}
+
+void TimerLoadSet64(uint32_t ui32Base, uint64_t ui64Value) {
+	(void) ui32Base;
+	timer_load = ui64Value;
+}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer) {
+	(void) ui32Base;
+	(void) ui32Timer;
+}
+
+/* Counts down from the load value from time zero. */
+uint64_t TimerValueGet64(uint32_t ui32Base) {
+	(void) ui32Base;
+	return timer_load - time_us * (timer_clock_hz / 1000000);
+}
+
+void tiva_stub_set_time(uint64_t microseconds) {
+	time_us = microseconds;
+}
+
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins) {
+	(void) ui32Port;
+	(void) ui8Pins;
+}
+
+void GPIOPinTypeI2C(uint32_t ui32Port, uint8_t ui8Pins) {
+	(void) ui32Port;
+	(void) ui8Pins;
+}
+
+void GPIOPinTypeI2CSCL(uint32_t ui32Port, uint8_t ui8Pins) {
+	(void) ui32Port;
+	(void) ui8Pins;
+}
+
+void GPIOPinConfigure(uint32_t ui32PinConfig) {
+	(void) ui32PinConfig;
+}
+
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32Strength,
+		uint32_t ui32PadType) {
+	(void) ui32Port;
+	(void) ui8Pins;
+	(void) ui32Strength;
+	(void) ui32PadType;
+}
+
+/* Only the accelerometer interrupt pins read high. */
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins) {
+	int32_t value = 0;
+	uint8_t i;
+	for (i = 0; i < ACCL_LINES; i++) {
+		if (accl_lines[i].port == ui32Port && (accl_lines[i].pin & ui8Pins)
+				&& accl_lines[i].level) {
+			value |= accl_lines[i].pin;
+		}
+	}
+	return value;
+}
+
+/* Port handlers are only kept for the accelerometer interrupt pins. */
+void GPIOIntRegister(uint32_t ui32Port, void (*pfnIntHandler)(void)) {
+	uint8_t i;
+	for (i = 0; i < ACCL_LINES; i++) {
+		if (accl_lines[i].port == ui32Port) {
+			accl_lines[i].handler = pfnIntHandler;
+		}
+	}
+}
+
+void GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType) {
+	uint8_t i;
+	for (i = 0; i < ACCL_LINES; i++) {
+		if (accl_lines[i].port == ui32Port && (accl_lines[i].pin & ui8Pins)) {
+			accl_lines[i].type = ui32IntType;
+		}
+	}
+}
+
+static void set_line_enables(uint32_t ui32Port, uint32_t ui32IntFlags, bool enabled) {
+	uint8_t i;
+	for (i = 0; i < ACCL_LINES; i++) {
+		if (accl_lines[i].port == ui32Port && (accl_lines[i].pin & ui32IntFlags)) {
+			accl_lines[i].enabled = enabled;
+		}
+	}
+}
+
+void GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags) {
+	set_line_enables(ui32Port, ui32IntFlags, true);
+}
+
+void GPIOIntDisable(uint32_t ui32Port, uint32_t ui32IntFlags) {
+	set_line_enables(ui32Port, ui32IntFlags, false);
+}
+
+/* Interrupts are taken as soon as they are raised, so there is nothing pending to clear. */
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags) {
+	(void) ui32Port;
+	(void) ui32IntFlags;
+}
+
+/* Follows the ADXL345 interrupt pins, running the handler of an enabled line
+ * when its level or edge matches the interrupt type. */
+void tiva_stub_update_gpio(void) {
+	uint8_t pins = adxl345_sim_int_pins();
+	uint8_t i;
+	for (i = 0; i < ACCL_LINES; i++) {
+		gpio_line_t *line = &accl_lines[i];
+		bool level = (pins >> i) & 1;
+		bool triggered;
+		switch (line->type) {
+		case GPIO_RISING_EDGE:
+			triggered = level && !line->level;
+			break;
+		case GPIO_BOTH_EDGES:
+			triggered = level != line->level;
+			break;
+		case GPIO_HIGH_LEVEL:
+			triggered = level;
+			break;
+		case GPIO_LOW_LEVEL:
+			triggered = !level;
+			break;
+		case GPIO_FALLING_EDGE:
+		default:
+			triggered = !level && line->level;
+			break;
+		}
+		line->level = level;
+		if (triggered && line->enabled && line->handler) {
+			line->handler();
+		}
+	}
+}
+
+void I2CMasterInitExpClk(uint32_t ui32Base, uint32_t ui32I2CClk, bool bFast) {
+	(void) ui32Base;
+	(void) ui32I2CClk;
+	(void) bFast;
+}
+
+void I2CMasterSlaveAddrSet(uint32_t ui32Base, uint8_t ui8SlaveAddr, bool bReceive) {
+	(void) ui32Base;
+	(void) ui8SlaveAddr;
+	i2c_receive = bReceive;
+}
+
+void I2CMasterDataPut(uint32_t ui32Base, uint8_t ui8Data) {
+	(void) ui32Base;
+	i2c_put_data = ui8Data;
+}
+
+uint32_t I2CMasterDataGet(uint32_t ui32Base) {
+	(void) ui32Base;
+	return i2c_get_data;
+}
+
+/* Starting a send latches the register address, later sends write to it and
+ * receives read from it, both advancing the address like the ADXL345 does. */
+void I2CMasterControl(uint32_t ui32Base, uint32_t ui32Cmd) {
+	(void) ui32Base;
+	if (i2c_receive) {
+		i2c_get_data = adxl345_sim_read(i2c_register++);
+	} else if (ui32Cmd == I2C_MASTER_CMD_BURST_SEND_START) {
+		i2c_register = i2c_put_data;
+	} else {
+		adxl345_sim_write(i2c_register++, i2c_put_data);
+	}
+	/* Reading INT_SOURCE and writing the interrupt setup change the pins at once. */
+	tiva_stub_update_gpio();
+}
+
+bool I2CMasterBusy(uint32_t ui32Base) {
+	(void) ui32Base;
+	return false;
+}
+
+/* i2c_driver.c waits while the bus is not busy, so report it as busy to never block. */
+bool I2CMasterBusBusy(uint32_t ui32Base) {
+	(void) ui32Base;
+	return true;
+}
+
+void ADCSequenceConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		uint32_t ui32Trigger, uint32_t ui32Priority) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+	(void) ui32Trigger;
+	(void) ui32Priority;
+}
+
+void ADCSequenceStepConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		uint32_t ui32Step, uint32_t ui32Config) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+	(void) ui32Step;
+	(void) ui32Config;
+}
+
+void ADCSequenceEnable(uint32_t ui32Base, uint32_t ui32SequenceNum) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+}
+
+int32_t ADCSequenceDataGet(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		uint32_t *pui32Buffer) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+	*pui32Buffer = 0;
+	return 1;
+}
+
+void ADCProcessorTrigger(uint32_t ui32Base, uint32_t ui32SequenceNum) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+}
+
+void ADCIntRegister(uint32_t ui32Base, uint32_t ui32SequenceNum,
+		void (*pfnHandler)(void)) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+	(void) pfnHandler;
+}
+
+void ADCIntEnable(uint32_t ui32Base, uint32_t ui32SequenceNum) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+}
+
+void ADCIntClear(uint32_t ui32Base, uint32_t ui32SequenceNum) {
+	(void) ui32Base;
+	(void) ui32SequenceNum;
+}
@@ -0,0 +1,25 @@
+/*
+ * File: tiva_stub.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Hooks into the host implementation of driverlib for tools driving the
+ * simulated hardware.
+ */
+
+#ifndef TIVA_STUB_H
+#define TIVA_STUB_H
+
+#include <stdint.h>
+
+/* Follows the ADXL345 interrupt pins, running the registered GPIO interrupt
+ * handler on an enabled edge as the NVIC would. Must be called after each
+ * sample set on the simulated accelerometer. */
+void tiva_stub_update_gpio(void);
+
+/* Sets the time since power on, which the timers count from. */
+void tiva_stub_set_time(uint64_t microseconds);
+
+#endif /* TIVA_STUB_H */
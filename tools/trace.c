@@ -0,0 +1,154 @@
+/*
+ * File: trace.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Loading of recorded accelerometer traces on the host.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "trace_file.h"
+
+#define DEFAULT_RATE_HZ 50
+
+/* Parses a signed integer that fits in an int16, advancing the text pointer past
+ * it and any blanks around it. Returns false if there is no number there or it
+ * does not fit. */
+static bool parse_int(const char **text, int16_t *value) {
+	const char *p = *text;
+	bool negative = false;
+	int32_t magnitude = 0;
+	while (*p == ' ' || *p == '\t') {
+		p++;
+	}
+	if (*p == '-') {
+		negative = true;
+		p++;
+	}
+	if (*p < '0' || *p > '9') {
+		return false;
+	}
+	while (*p >= '0' && *p <= '9') {
+		magnitude = magnitude * 10 + (*p - '0');
+		if (magnitude > -INT16_MIN) {
+			return false;
+		}
+		p++;
+	}
+	if (magnitude > INT16_MAX && !negative) {
+		return false;
+	}
+	while (*p == ' ' || *p == '\t') {
+		p++;
+	}
+	*text = p;
+	*value = (int16_t) (negative ? -magnitude : magnitude);
+	return true;
+}
+
+/* Parses an "x,y,z" line into sample i of the trace. Returns false unless the
+ * line holds exactly three readings. */
+static bool parse_sample(const char *line, trace_t *trace, uint32_t i) {
+	const char *p = line;
+	if (!parse_int(&p, &trace->x[i]) || *p++ != ','
+			|| !parse_int(&p, &trace->y[i]) || *p++ != ','
+			|| !parse_int(&p, &trace->z[i])) {
+		return false;
+	}
+	return *p == '\n' || *p == '\r' || *p == '\0';
+}
+
+static bool grow(trace_t *trace, uint32_t *capacity) {
+	uint32_t new_capacity = *capacity ? *capacity * 2 : 4096;
+	int16_t *x = realloc(trace->x, new_capacity * sizeof(int16_t));
+	int16_t *y = realloc(trace->y, new_capacity * sizeof(int16_t));
+	int16_t *z = realloc(trace->z, new_capacity * sizeof(int16_t));
+	if (x != NULL) {
+		trace->x = x;
+	}
+	if (y != NULL) {
+		trace->y = y;
+	}
+	if (z != NULL) {
+		trace->z = z;
+	}
+	if (x == NULL || y == NULL || z == NULL) {
+		return false;
+	}
+	*capacity = new_capacity;
+	return true;
+}
+
+/* Loads a CSV trace or a binary trace file into memory. */
+bool load_trace(trace_t *trace, const char *path) {
+	if (is_trace_file(path)) {
+		return load_trace_file(trace, path);
+	}
+	memset(trace, 0, sizeof(*trace));
+	trace->rate_hz = DEFAULT_RATE_HZ;
+	trace->steps = -1;
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		perror(path);
+		return false;
+	}
+	uint32_t capacity = 0;
+	uint32_t line_number = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		line_number++;
+		if (strchr(line, '\n') == NULL && !feof(file)) {
+			fprintf(stderr, "%s:%u: line too long\n", path, line_number);
+			fclose(file);
+			free_trace(trace);
+			return false;
+		}
+		if (line[0] == '#') {
+			unsigned value;
+			if (sscanf(line, "# rate_hz %u", &value) == 1 && value > 0) {
+				trace->rate_hz = value;
+			} else if (sscanf(line, "# steps %u", &value) == 1) {
+				trace->steps = value;
+			}
+			continue;
+		}
+		if (line[0] == '\n' || line[0] == '\r') {
+			continue;
+		}
+		if (trace->length == capacity && !grow(trace, &capacity)) {
+			fprintf(stderr, "%s: out of memory\n", path);
+			fclose(file);
+			free_trace(trace);
+			return false;
+		}
+		if (!parse_sample(line, trace, trace->length)) {
+			fprintf(stderr, "%s:%u: expected x,y,z readings: %s", path, line_number, line);
+			if (strchr(line, '\n') == NULL) {
+				fputc('\n', stderr);
+			}
+			fclose(file);
+			free_trace(trace);
+			return false;
+		}
+		trace->length++;
+	}
+	fclose(file);
+	return true;
+}
+
+/* Releases the memory held by a loaded trace. */
+void free_trace(trace_t *trace) {
+	free(trace->x);
+	free(trace->y);
+	free(trace->z);
+	memset(trace, 0, sizeof(*trace));
+}
@@ -0,0 +1,39 @@
+/*
+ * File: trace.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Loading of recorded accelerometer traces on the host.
+ *
+ * A CSV trace has one "x,y,z" line of raw full resolution readings per sample.
+ * Lines starting with '#' are comments, except "# rate_hz N" which gives the
+ * sample rate and "# steps N" which gives the number of steps actually taken.
+ * Binary trace files, as trace_file.h, load the same way.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint32_t rate_hz;   /* Sample rate, 50 if the trace does not say. */
+	int32_t steps;      /* Steps actually taken, -1 if not known. */
+	uint32_t length;    /* Number of samples. */
+	int16_t *x;         /* Samples, one array per axis. */
+	int16_t *y;
+	int16_t *z;
+} trace_t;
+
+/* Loads a CSV trace or a binary trace file into memory. Returns false and prints
+ * an error on failure, with the line of a CSV trace that is not a comment, blank
+ * or three int16 readings. */
+bool load_trace(trace_t *trace, const char *path);
+
+/* Releases the memory held by a loaded trace. */
+void free_trace(trace_t *trace);
+
+#endif /* TRACE_H */
@@ -0,0 +1,305 @@
+/*
+ * File: trace_file.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Binary accelerometer traces on the host, read through a memory mapping.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace_file.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "trace files are read in place, which needs a little endian host"
+#endif
+
+/* Words summed in 32 bits before the checksum sums are carried into 64 bits. */
+#define CHECKSUM_CHUNK 128
+
+/* Rounds a size up to the alignment of the arrays in the file. */
+static size_t align_size(size_t size) {
+	return (size + TRACE_FILE_ALIGN - 1) / TRACE_FILE_ALIGN * TRACE_FILE_ALIGN;
+}
+
+/* Returns the bytes of a block, x, y and z of block_samples readings each. */
+static size_t block_size(uint32_t block_samples) {
+	return (size_t) block_samples * 3 * sizeof(int16_t);
+}
+
+/* Returns the bytes of the checksum table, 0 if there is none. */
+static size_t checksums_size(uint32_t flags, uint32_t blocks) {
+	return flags & TRACE_FILE_CHECKSUMS ? align_size(blocks * sizeof(uint32_t)) : 0;
+}
+
+/* Reads a field of the header. */
+static uint32_t read_u32(const uint8_t *header, size_t offset) {
+	uint32_t value;
+	memcpy(&value, header + offset, sizeof(value));
+	return value;
+}
+
+static uint16_t read_u16(const uint8_t *header, size_t offset) {
+	uint16_t value;
+	memcpy(&value, header + offset, sizeof(value));
+	return value;
+}
+
+/* Returns true if the file starts with the trace file magic. */
+bool is_trace_file(const char *path) {
+	char magic[4];
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+			&& memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) == 0;
+	fclose(file);
+	return match;
+}
+
+/* Maps a trace file and checks its header and size. */
+bool open_trace_file(trace_file_t *file, const char *path) {
+	memset(file, 0, sizeof(*file));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		perror(path);
+		close(fd);
+		return false;
+	}
+	size_t size = st.st_size;
+	if (size < TRACE_FILE_HEADER_SIZE) {
+		fprintf(stderr, "%s: too short for a trace file\n", path);
+		close(fd);
+		return false;
+	}
+	const uint8_t *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		perror(path);
+		return false;
+	}
+	file->map = map;
+	file->map_size = size;
+
+	uint16_t header_size = read_u16(map, 6);
+	file->version = read_u16(map, 4);
+	file->flags = read_u32(map, 8);
+	file->device_id = read_u32(map, 12);
+	file->rate_hz = read_u16(map, 16);
+	file->range_g = map[18];
+	file->block_samples = read_u32(map, 20);
+	file->length = read_u32(map, 24);
+	file->steps = (int32_t) read_u32(map, 28);
+	const char *error = NULL;
+	if (memcmp(map, TRACE_FILE_MAGIC, 4) != 0) {
+		error = "not a trace file";
+	} else if (file->version > TRACE_FILE_VERSION) {
+		error = "trace file version is newer than this reader";
+	} else if (header_size < TRACE_FILE_HEADER_SIZE || header_size % TRACE_FILE_ALIGN != 0
+			|| header_size > size) {
+		error = "bad header size";
+	} else if (file->block_samples == 0 || file->block_samples % 32 != 0
+			|| file->block_samples > TRACE_FILE_MAX_BLOCK || file->rate_hz == 0) {
+		error = "bad samples per block or sample rate";
+	}
+	if (error == NULL) {
+		file->blocks = (file->length + file->block_samples - 1) / file->block_samples;
+		size_t table = checksums_size(file->flags, file->blocks);
+		if (size - header_size < table
+				|| (size - header_size - table) / block_size(file->block_samples) < file->blocks) {
+			error = "truncated";
+		} else {
+			file->checksums = table ? (const uint32_t *) (map + header_size) : NULL;
+			file->data = map + header_size + table;
+		}
+	}
+	if (error != NULL) {
+		fprintf(stderr, "%s: %s\n", path, error);
+		close_trace_file(file);
+		return false;
+	}
+	return true;
+}
+
+/* Unmaps a trace file. */
+void close_trace_file(trace_file_t *file) {
+	if (file->map != NULL) {
+		munmap((void *) file->map, file->map_size);
+	}
+	memset(file, 0, sizeof(*file));
+}
+
+/* Points x, y and z at the readings of a block in the mapping. */
+uint32_t trace_file_block(const trace_file_t *file, uint32_t block, const int16_t **x,
+		const int16_t **y, const int16_t **z) {
+	const int16_t *start = (const int16_t *) (file->data + block * block_size(file->block_samples));
+	*x = start;
+	*y = start + file->block_samples;
+	*z = start + 2 * file->block_samples;
+	uint32_t first = block * file->block_samples;
+	return file->length - first < file->block_samples ? file->length - first : file->block_samples;
+}
+
+/* Returns true if a block matches its checksum, or the file has none. */
+bool check_trace_file_block(const trace_file_t *file, uint32_t block) {
+	if (file->checksums == NULL) {
+		return true;
+	}
+	const int16_t *words = (const int16_t *) (file->data + block * block_size(file->block_samples));
+	return trace_file_checksum(words, 3 * file->block_samples) == file->checksums[block];
+}
+
+/* Returns the Fletcher-32 checksum of count int16 words. The sums are taken modulo
+ * 65535 at the end rather than after every word, which gives the same result.
+ * The second sum weights each word by the number of words from it to the end. */
+uint32_t trace_file_checksum(const int16_t *words, uint32_t count) {
+	uint64_t sum1 = 0;
+	uint64_t sum2 = 0;
+	uint32_t done = 0;
+	while (done < count) {
+		uint32_t n = count - done < CHECKSUM_CHUNK ? count - done : CHECKSUM_CHUNK;
+		/* Within a chunk both sums fit in 32 bits. */
+		uint32_t chunk1 = 0;
+		uint32_t chunk2 = 0;
+		uint32_t i;
+		for (i = 0; i < n; i++) {
+			uint32_t word = (uint16_t) words[done + i];
+			chunk1 += word;
+			chunk2 += (n - i) * word;
+		}
+		done += n;
+		sum2 += (uint64_t) (count - done) * chunk1 + chunk2;
+		sum1 += chunk1;
+	}
+	return (uint32_t) (sum2 % 65535) << 16 | (uint32_t) (sum1 % 65535);
+}
+
+/* Writes a trace to a trace file. */
+bool write_trace_file(const char *path, const trace_t *trace, uint32_t device_id,
+		uint8_t range_g, uint32_t block_samples, uint32_t flags) {
+	if (block_samples == 0 || block_samples % 32 != 0 || block_samples > TRACE_FILE_MAX_BLOCK) {
+		fprintf(stderr, "%s: samples per block must be a multiple of 32 up to %u\n", path,
+				TRACE_FILE_MAX_BLOCK);
+		return false;
+	}
+	uint32_t blocks = (trace->length + block_samples - 1) / block_samples;
+	size_t table = checksums_size(flags, blocks);
+	int16_t *block = calloc(3 * block_samples, sizeof(int16_t));
+	uint32_t *checksums = calloc(table ? table : 1, 1);
+	FILE *file = fopen(path, "wb");
+	if (block == NULL || checksums == NULL || file == NULL) {
+		if (file == NULL) {
+			perror(path);
+		} else {
+			fprintf(stderr, "%s: out of memory\n", path);
+			fclose(file);
+		}
+		free(block);
+		free(checksums);
+		return false;
+	}
+
+	uint8_t header[TRACE_FILE_HEADER_SIZE] = { 0 };
+	uint16_t version = TRACE_FILE_VERSION;
+	uint16_t header_size = TRACE_FILE_HEADER_SIZE;
+	uint16_t rate_hz = trace->rate_hz;
+	memcpy(header, TRACE_FILE_MAGIC, 4);
+	memcpy(header + 4, &version, 2);
+	memcpy(header + 6, &header_size, 2);
+	memcpy(header + 8, &flags, 4);
+	memcpy(header + 12, &device_id, 4);
+	memcpy(header + 16, &rate_hz, 2);
+	header[18] = range_g;
+	memcpy(header + 20, &block_samples, 4);
+	memcpy(header + 24, &trace->length, 4);
+	memcpy(header + 28, &trace->steps, 4);
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+	/* The checksum table is written first as zeros and filled in at the end. */
+	if (table) {
+		ok = ok && fwrite(checksums, table, 1, file) == 1;
+	}
+	uint32_t b;
+	for (b = 0; ok && b < blocks; b++) {
+		uint32_t first = b * block_samples;
+		uint32_t n = trace->length - first < block_samples ? trace->length - first : block_samples;
+		memset(block, 0, block_size(block_samples));
+		memcpy(block, trace->x + first, n * sizeof(int16_t));
+		memcpy(block + block_samples, trace->y + first, n * sizeof(int16_t));
+		memcpy(block + 2 * block_samples, trace->z + first, n * sizeof(int16_t));
+		if (table) {
+			checksums[b] = trace_file_checksum(block, 3 * block_samples);
+		}
+		ok = fwrite(block, block_size(block_samples), 1, file) == 1;
+	}
+	if (table && ok) {
+		ok = fseek(file, TRACE_FILE_HEADER_SIZE, SEEK_SET) == 0
+				&& fwrite(checksums, table, 1, file) == 1;
+	}
+	ok = fclose(file) == 0 && ok;
+	if (!ok) {
+		perror(path);
+	}
+	free(block);
+	free(checksums);
+	return ok;
+}
+
+/* Loads a trace file into a trace in memory, copying the samples. */
+bool load_trace_file(trace_t *trace, const char *path) {
+	trace_file_t file;
+	memset(trace, 0, sizeof(*trace));
+	if (!open_trace_file(&file, path)) {
+		return false;
+	}
+	trace->rate_hz = file.rate_hz;
+	trace->steps = file.steps;
+	trace->length = file.length;
+	size_t size = (file.length ? file.length : 1) * sizeof(int16_t);
+	trace->x = malloc(size);
+	trace->y = malloc(size);
+	trace->z = malloc(size);
+	if (trace->x == NULL || trace->y == NULL || trace->z == NULL) {
+		fprintf(stderr, "%s: out of memory\n", path);
+		close_trace_file(&file);
+		free_trace(trace);
+		return false;
+	}
+	uint32_t b;
+	for (b = 0; b < file.blocks; b++) {
+		const int16_t *x;
+		const int16_t *y;
+		const int16_t *z;
+		uint32_t n = trace_file_block(&file, b, &x, &y, &z);
+		uint32_t first = b * file.block_samples;
+		if (!check_trace_file_block(&file, b)) {
+			fprintf(stderr, "%s: block %u does not match its checksum\n", path, b);
+			close_trace_file(&file);
+			free_trace(trace);
+			return false;
+		}
+		memcpy(trace->x + first, x, n * sizeof(int16_t));
+		memcpy(trace->y + first, y, n * sizeof(int16_t));
+		memcpy(trace->z + first, z, n * sizeof(int16_t));
+	}
+	close_trace_file(&file);
+	return true;
+}
@@ -0,0 +1,107 @@
+/*
+ * File: trace_file.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Binary accelerometer traces on the host, read through a memory mapping so the
+ * samples are used where they lie in the file without being copied or parsed.
+ *
+ * A trace file is a header, an optional table of block checksums and the blocks
+ * of samples. Every block holds block_samples readings as separate x, y and z
+ * arrays of int16, so each block can be passed straight to push_step_block. The
+ * last block is padded with zeros. The header and the checksum table are padded
+ * to TRACE_FILE_ALIGN bytes and block_samples is a multiple of 32, so every array
+ * starts TRACE_FILE_ALIGN aligned in the mapping. All fields are little endian,
+ * as on the TM4C123 and x86 hosts.
+ *
+ * Header, TRACE_FILE_HEADER_SIZE bytes in version 1:
+ *   0  magic, "ACCT"
+ *   4  uint16 version, readers reject a later version than they know
+ *   6  uint16 header size, so later versions can add fields after these
+ *   8  uint32 flags, TRACE_FILE_CHECKSUMS
+ *  12  uint32 device id
+ *  16  uint16 sample rate in Hz
+ *  18  uint8 measurement range in g
+ *  19  uint8 reserved, 0
+ *  20  uint32 samples per block
+ *  24  uint32 number of samples
+ *  28  int32 steps actually taken, -1 if not known
+ *  32  reserved to the end of the header, 0
+ * Block checksums are Fletcher-32 over the int16 words of the whole block, zero
+ * padding included.
+ */
+
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+#define TRACE_FILE_MAGIC "ACCT"
+#define TRACE_FILE_VERSION 1
+#define TRACE_FILE_HEADER_SIZE 64
+#define TRACE_FILE_ALIGN 64
+
+/* The header flag for a table of block checksums. */
+#define TRACE_FILE_CHECKSUMS 0x1
+
+/* Samples per block written by default, 2^14 keeps each of x, y and z of a block
+ * in 32KB, in the L1 cache while the detector runs over it. The largest allowed
+ * is the largest multiple of 32 push_step_block takes at once. */
+#define TRACE_FILE_DEFAULT_BLOCK 16384
+#define TRACE_FILE_MAX_BLOCK 65504
+
+typedef struct {
+	uint16_t version;
+	uint32_t flags;
+	uint32_t device_id;
+	uint16_t rate_hz;
+	uint8_t range_g;
+	uint32_t block_samples;
+	uint32_t length;          /* Number of samples. */
+	int32_t steps;            /* Steps actually taken, -1 if not known. */
+	uint32_t blocks;          /* Number of blocks, the last may be part full. */
+	const uint32_t *checksums;  /* Checksum of each block in the mapping, 0 if none. */
+	const uint8_t *data;      /* First block in the mapping. */
+	const uint8_t *map;
+	size_t map_size;
+} trace_file_t;
+
+/* Returns true if the file starts with the trace file magic, false if it does not
+ * or cannot be read. */
+bool is_trace_file(const char *path);
+
+/* Maps a trace file and checks its header and size. The blocks are not checked
+ * against their checksums. Returns false and prints an error on failure. */
+bool open_trace_file(trace_file_t *file, const char *path);
+
+/* Unmaps a trace file. */
+void close_trace_file(trace_file_t *file);
+
+/* Points x, y and z at the readings of a block in the mapping, and returns the
+ * number of readings in it. */
+uint32_t trace_file_block(const trace_file_t *file, uint32_t block, const int16_t **x,
+		const int16_t **y, const int16_t **z);
+
+/* Returns true if a block matches its checksum, or the file has none. */
+bool check_trace_file_block(const trace_file_t *file, uint32_t block);
+
+/* Returns the Fletcher-32 checksum of count int16 words. */
+uint32_t trace_file_checksum(const int16_t *words, uint32_t count);
+
+/* Writes a trace to a trace file with the given device id, range in g, samples per
+ * block, a multiple of 32 up to TRACE_FILE_MAX_BLOCK, and flags. Returns false and
+ * prints an error on failure. */
+bool write_trace_file(const char *path, const trace_t *trace, uint32_t device_id,
+		uint8_t range_g, uint32_t block_samples, uint32_t flags);
+
+/* Loads a trace file into a trace in memory, copying the samples, for code that
+ * needs each axis in one array. Returns false and prints an error on failure. */
+bool load_trace_file(trace_t *trace, const char *path);
+
+#endif /* TRACE_FILE_H */
@@ -0,0 +1,348 @@
+/*
+ * File: tracebin.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Converts CSV accelerometer traces to binary trace files, and benchmarks
+ * reading either. A binary trace is read in place through its mapping, once
+ * summing every reading as the cheapest use of the samples, and once checking
+ * every block against its checksum. A CSV trace is parsed into memory. With -z
+ * the readings of each axis are packed with sample_codec.c instead, reporting how
+ * small they pack and how fast they are packed and unpacked.
+ *
+ * Usage:
+ *   tracebin [-c] [-i device_id] [-g range_g] [-b block_samples] in.csv out.trace
+ *   tracebin -r trace...
+ *   tracebin -z trace...
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -Itools -I. tools/tracebin.c tools/trace.c tools/trace_file.c \
+ *       sample_codec.c -o tracebin
+ * adding -mavx2 to unpack with AVX2 as well.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "trace_file.h"
+#include "sample_codec.h"
+
+/* Each read benchmark repeats for at least this long. */
+#define MIN_BENCH_NS 200000000u
+
+/* The range of the recordings, the firmware's default of 16g, unless given. */
+#define DEFAULT_RANGE_G 16
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: tracebin [-c] [-i device_id] [-g range_g] [-b block_samples]"
+			" in.csv out.trace\n"
+			"       tracebin -r trace...\n"
+			"       tracebin -z trace...\n"
+			"  -c  write block checksums\n"
+			"  -r  benchmark reading the traces\n"
+			"  -z  benchmark packing the traces\n");
+	exit(1);
+}
+
+/* Sums every reading of every block in place. */
+static int64_t sum_trace_file(const trace_file_t *file) {
+	int64_t sum = 0;
+	uint32_t b;
+	for (b = 0; b < file->blocks; b++) {
+		const int16_t *x;
+		const int16_t *y;
+		const int16_t *z;
+		uint32_t n = trace_file_block(file, b, &x, &y, &z);
+		int32_t block_sum = 0;
+		uint32_t i;
+		for (i = 0; i < n; i++) {
+			block_sum += x[i] + y[i] + z[i];
+		}
+		sum += block_sum;
+	}
+	return sum;
+}
+
+/* Checks every block against its checksum, returning the number that fail. */
+static uint32_t check_trace_file(const trace_file_t *file) {
+	uint32_t failed = 0;
+	uint32_t b;
+	for (b = 0; b < file->blocks; b++) {
+		failed += !check_trace_file_block(file, b);
+	}
+	return failed;
+}
+
+/* Prints the rate a trace was read at, over passes of bytes each. */
+static void print_rate(const char *path, const char *what, uint32_t passes, uint64_t bytes,
+		uint64_t elapsed) {
+	printf("%s: %s %.2f GB/s, %.1f M samples/s\n", path, what,
+			(double) bytes * passes / elapsed,
+			(double) bytes / (3 * sizeof(int16_t)) * passes * 1e3 / elapsed);
+}
+
+static void bench_trace_file(const char *path) {
+	trace_file_t file;
+	if (!open_trace_file(&file, path)) {
+		return;
+	}
+	uint64_t bytes = (uint64_t) file.length * 3 * sizeof(int16_t);
+	int64_t sum = sum_trace_file(&file);  /* Faults the pages in before timing. */
+	int64_t total = 0;
+	uint32_t passes = 0;
+	uint64_t start = now_ns();
+	uint64_t elapsed;
+	do {
+		total += sum_trace_file(&file);
+		passes++;
+		elapsed = now_ns() - start;
+	} while (elapsed < MIN_BENCH_NS);
+	print_rate(path, "mapped read", passes, bytes, elapsed);
+	if (total != sum * passes) {
+		printf("%s: readings changed between passes\n", path);
+	}
+
+	if (file.checksums != NULL) {
+		uint32_t failed = 0;
+		passes = 0;
+		start = now_ns();
+		do {
+			failed += check_trace_file(&file);
+			passes++;
+			elapsed = now_ns() - start;
+		} while (elapsed < MIN_BENCH_NS);
+		print_rate(path, "checked read", passes, bytes, elapsed);
+		if (failed != 0) {
+			printf("%s: %u blocks do not match their checksums\n", path, failed / passes);
+		}
+	}
+	printf("%s: %u samples at %uHz, %ug, device %u, sum %lld\n", path, file.length,
+			file.rate_hz, file.range_g, file.device_id, (long long) sum);
+	close_trace_file(&file);
+}
+
+static void bench_csv(const char *path) {
+	trace_t trace;
+	uint64_t start = now_ns();
+	if (!load_trace(&trace, path)) {
+		return;
+	}
+	uint64_t elapsed = now_ns() - start;
+	print_rate(path, "parsed", 1, (uint64_t) trace.length * 3 * sizeof(int16_t), elapsed);
+	free_trace(&trace);
+}
+
+/* The readings of each axis of a trace in whole blocks for the codec, and the
+ * blocks packed. */
+typedef struct {
+	uint32_t blocks;
+	int16_t *readings[3];
+	uint8_t *packed[3];
+	uint32_t packed_size[3];
+} packed_trace_t;
+
+/* Packs every block of each axis, each predicted from the block before. */
+static void pack_trace(packed_trace_t *packed) {
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		const int16_t *readings = packed->readings[axis];
+		uint32_t size = 0;
+		uint32_t b;
+		for (b = 0; b < packed->blocks; b++) {
+			int16_t previous = b ? readings[-1] : readings[0];
+			size += encode_sample_block(readings, previous, packed->packed[axis] + size);
+			readings += SAMPLE_CODEC_BLOCK;
+		}
+		packed->packed_size[axis] = size;
+	}
+}
+
+/* Unpacks every block of each axis into out, three arrays of blocks each. Returns
+ * false if a block does not unpack to the readings packed. */
+static bool unpack_trace(const packed_trace_t *packed, int16_t *out,
+		uint16_t (*decode)(const uint8_t *, int16_t *)) {
+	bool match = true;
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		const uint8_t *block = packed->packed[axis];
+		int16_t *readings = out + axis * packed->blocks * SAMPLE_CODEC_BLOCK;
+		uint32_t b;
+		for (b = 0; b < packed->blocks; b++) {
+			uint16_t size = decode(block, readings);
+			match = match && size != 0;
+			block += size;
+			readings += SAMPLE_CODEC_BLOCK;
+		}
+	}
+	return match;
+}
+
+/* Times unpacking a trace, and checks the readings come back as they were. */
+static void bench_unpack(const char *path, const char *what, const packed_trace_t *packed,
+		int16_t *out, uint64_t bytes, uint16_t (*decode)(const uint8_t *, int16_t *)) {
+	uint32_t passes = 0;
+	uint64_t start = now_ns();
+	uint64_t elapsed;
+	bool valid = true;
+	do {
+		valid = unpack_trace(packed, out, decode) && valid;
+		passes++;
+		elapsed = now_ns() - start;
+	} while (elapsed < MIN_BENCH_NS);
+	print_rate(path, what, passes, bytes, elapsed);
+	size_t axis_size = (size_t) packed->blocks * SAMPLE_CODEC_BLOCK * sizeof(int16_t);
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		valid = valid && memcmp(out + axis * packed->blocks * SAMPLE_CODEC_BLOCK,
+				packed->readings[axis], axis_size) == 0;
+	}
+	if (!valid) {
+		printf("%s: %s readings differ from those packed\n", path, what);
+	}
+}
+
+static void bench_codec(const char *path) {
+	trace_t trace;
+	if (!load_trace(&trace, path) || trace.length == 0) {
+		return;
+	}
+	packed_trace_t packed;
+	packed.blocks = (trace.length + SAMPLE_CODEC_BLOCK - 1) / SAMPLE_CODEC_BLOCK;
+	uint32_t padded = packed.blocks * SAMPLE_CODEC_BLOCK;
+	int16_t *out = malloc((size_t) padded * 3 * sizeof(int16_t));
+	bool ok = out != NULL;
+	const int16_t *axes[3] = { trace.x, trace.y, trace.z };
+	uint8_t axis;
+	for (axis = 0; axis < 3; axis++) {
+		packed.readings[axis] = malloc((size_t) padded * sizeof(int16_t));
+		packed.packed[axis] = malloc((size_t) packed.blocks * SAMPLE_CODEC_MAX_BYTES);
+		ok = ok && packed.readings[axis] != NULL && packed.packed[axis] != NULL;
+	}
+	if (ok) {
+		/* The last block is padded by repeating the last reading, which packs to
+		 * nothing. */
+		for (axis = 0; axis < 3; axis++) {
+			uint32_t i;
+			for (i = 0; i < padded; i++) {
+				packed.readings[axis][i] = axes[axis][i < trace.length ? i : trace.length - 1];
+			}
+		}
+		uint64_t bytes = (uint64_t) padded * 3 * sizeof(int16_t);
+		uint32_t passes = 0;
+		uint64_t start = now_ns();
+		uint64_t elapsed;
+		do {
+			pack_trace(&packed);
+			passes++;
+			elapsed = now_ns() - start;
+		} while (elapsed < MIN_BENCH_NS);
+		print_rate(path, "packed", passes, bytes, elapsed);
+		bench_unpack(path, "unpacked", &packed, out, bytes, decode_sample_block_c);
+#if defined(__AVX2__)
+		bench_unpack(path, "unpacked with AVX2", &packed, out, bytes, decode_sample_block_avx2);
+#endif
+
+		/* How often each prediction is used and the bits per reading it leaves. */
+		uint32_t linear = 0;
+		uint64_t size = 0;
+		for (axis = 0; axis < 3; axis++) {
+			const uint8_t *block = packed.packed[axis];
+			uint32_t b;
+			for (b = 0; b < packed.blocks; b++) {
+				linear += block[1] == SAMPLE_CODEC_LINEAR;
+				block += sample_block_size(block);
+			}
+			size += packed.packed_size[axis];
+		}
+		printf("%s: %llu bytes packed into %llu, ratio %.2f, %.2f bits per reading,"
+				" %.0f%% of blocks linear\n", path, (unsigned long long) bytes,
+				(unsigned long long) size, (double) bytes / size, size * 8.0 / (3.0 * padded),
+				linear * 100.0 / (3.0 * packed.blocks));
+	} else {
+		fprintf(stderr, "%s: out of memory\n", path);
+	}
+	for (axis = 0; axis < 3; axis++) {
+		free(packed.readings[axis]);
+		free(packed.packed[axis]);
+	}
+	free(out);
+	free_trace(&trace);
+}
+
+int main(int argc, char *argv[]) {
+	bool bench = false;
+	bool bench_packing = false;
+	uint32_t flags = 0;
+	uint32_t device_id = 0;
+	uint8_t range_g = DEFAULT_RANGE_G;
+	uint32_t block_samples = TRACE_FILE_DEFAULT_BLOCK;
+	int opt;
+	while ((opt = getopt(argc, argv, "rzci:g:b:")) != -1) {
+		switch (opt) {
+		case 'r':
+			bench = true;
+			break;
+		case 'z':
+			bench_packing = true;
+			break;
+		case 'c':
+			flags |= TRACE_FILE_CHECKSUMS;
+			break;
+		case 'i':
+			device_id = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			range_g = atoi(optarg);
+			break;
+		case 'b':
+			block_samples = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (bench || bench_packing) {
+		if (optind >= argc) {
+			usage();
+		}
+		int i;
+		for (i = optind; i < argc; i++) {
+			if (bench_packing) {
+				bench_codec(argv[i]);
+			} else if (is_trace_file(argv[i])) {
+				bench_trace_file(argv[i]);
+			} else {
+				bench_csv(argv[i]);
+			}
+		}
+		return 0;
+	}
+
+	if (argc - optind != 2) {
+		usage();
+	}
+	trace_t trace;
+	if (!load_trace(&trace, argv[optind])) {
+		return 1;
+	}
+	bool ok = write_trace_file(argv[optind + 1], &trace, device_id, range_g, block_samples,
+			flags);
+	free_trace(&trace);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+/*
+ * File: tracegen.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Generates synthetic accelerometer traces in the CSV trace format for replaying
+ * through the step detector on the host. Traces are raw full resolution readings
+ * (256 LSB per g) made of segments of activity, and the number of steps taken
+ * is written at the end of the trace so replays can report accuracy.
+ *
+ * Usage: tracegen [-r rate_hz] [-s seed] [-p pitch_deg] [-l roll_deg] [-b bias]
+ *                 segment...
+ * Segments are still:seconds, walk:seconds[:cadence_spm[:amplitude_mg[:sway_mg]]],
+ * run:seconds[:cadence_spm[:amplitude_mg[:sway_mg]]] and bumpy:seconds[:amplitude_mg]
+ * for riding in a vehicle, which has no steps.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 tools/tracegen.c -lm -o tracegen
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#define LSB_PER_G 256.0
+#define MAX_READING 4095
+#define PI 3.14159265358979323846
+
+typedef struct {
+	double x;
+	double y;
+	double z;
+} vec_t;
+
+/* Rotation from the world frame (z up) into the device frame. */
+static double rotation[3][3];
+
+static double noise_lsb = 1.5;
+static uint32_t rate_hz = 50;
+static uint32_t steps_taken;
+static uint64_t sample_index;
+static vec_t bias;
+
+/* Uniform random number in [0, 1). */
+static double uniform(void) {
+	return rand() / ((double) RAND_MAX + 1.0);
+}
+
+/* Normally distributed random number with zero mean and unit deviation. */
+static double gaussian(void) {
+	double u = uniform() + 1e-12;
+	double v = uniform();
+	return sqrt(-2.0 * log(u)) * cos(2.0 * PI * v);
+}
+
+static void set_orientation(double pitch_deg, double roll_deg) {
+	double p = pitch_deg * PI / 180.0;
+	double r = roll_deg * PI / 180.0;
+	/* Device frame = Rx(roll) * Ry(pitch) * world frame. */
+	double cp = cos(p), sp = sin(p), cr = cos(r), sr = sin(r);
+	double m[3][3] = {
+		{ cp, 0, -sp },
+		{ sr * sp, cr, sr * cp },
+		{ cr * sp, -sr, cr * cp },
+	};
+	memcpy(rotation, m, sizeof(m));
+}
+
+/* Writes one sample given the acceleration in the world frame in g, gravity excluded. */
+static void emit(vec_t world) {
+	vec_t total = { world.x, world.y, world.z + 1.0 };
+	double device[3];
+	int i;
+	for (i = 0; i < 3; i++) {
+		device[i] = rotation[i][0] * total.x + rotation[i][1] * total.y
+				+ rotation[i][2] * total.z;
+	}
+	double offsets[3] = { bias.x, bias.y, bias.z };
+	long reading[3];
+	for (i = 0; i < 3; i++) {
+		double value = device[i] * LSB_PER_G + offsets[i] + noise_lsb * gaussian();
+		reading[i] = lround(value);
+		if (reading[i] > MAX_READING) {
+			reading[i] = MAX_READING;
+		} else if (reading[i] < -MAX_READING - 1) {
+			reading[i] = -MAX_READING - 1;
+		}
+	}
+	printf("%ld,%ld,%ld\n", reading[0], reading[1], reading[2]);
+	sample_index++;
+}
+
+static void generate_still(double seconds) {
+	uint64_t n = (uint64_t) (seconds * rate_hz);
+	uint64_t i;
+	vec_t zero = { 0, 0, 0 };
+	for (i = 0; i < n; i++) {
+		emit(zero);
+	}
+}
+
+/* Walking and running, one vertical cycle per step with a heel strike at the start
+ * of each step and a side to side sway at half the step rate. Step times and
+ * strength jitter like a real gait and the body adds slow random wobble. */
+static void generate_gait(double seconds, double cadence_spm, double amplitude_mg,
+		double sway_mg) {
+	double amplitude = amplitude_mg / 1000.0;
+	double sway = sway_mg / 1000.0;
+	uint64_t n = (uint64_t) (seconds * rate_hz);
+	double phase = 0;
+	double period = 60.0 / cadence_spm;
+	double step_period = period * (1.0 + 0.04 * gaussian());
+	double step_amplitude = amplitude * (1.0 + 0.2 * gaussian());
+	vec_t wobble = { 0, 0, 0 };
+	double wobble_decay = exp(-2.0 / rate_hz);
+	double wobble_kick = 0.15 * amplitude * sqrt(1 - wobble_decay * wobble_decay);
+	uint64_t i;
+	for (i = 0; i < n; i++) {
+		double s = phase;
+		double stride = (steps_taken % 2 == 0 ? 0.0 : 0.5) + s * 0.5;
+		double heel = 0.8 * step_amplitude * exp(-s * period / 0.02);
+		wobble.x = wobble.x * wobble_decay + wobble_kick * gaussian();
+		wobble.y = wobble.y * wobble_decay + wobble_kick * gaussian();
+		wobble.z = wobble.z * wobble_decay + wobble_kick * gaussian();
+		vec_t a;
+		a.z = step_amplitude * (sin(2 * PI * s) + 0.3 * sin(4 * PI * s + 0.5))
+				+ heel + wobble.z;
+		a.x = 0.3 * step_amplitude * sin(2 * PI * s + 1.2) + 0.3 * heel + wobble.x;
+		a.y = sway * sin(2 * PI * stride) + wobble.y;
+		emit(a);
+		phase += 1.0 / (rate_hz * step_period);
+		if (phase >= 1.0) {
+			phase -= 1.0;
+			steps_taken++;
+			step_period = period * (1.0 + 0.04 * gaussian());
+			step_amplitude = amplitude * (1.0 + 0.2 * gaussian());
+		}
+	}
+}
+
+/* Riding in a vehicle: road bumps that make the body bounce at 2-6Hz, no steps. */
+static void generate_bumpy(double seconds, double amplitude_mg) {
+	double amplitude = amplitude_mg / 1000.0;
+	uint64_t n = (uint64_t) (seconds * rate_hz);
+	double ring = 0;
+	double ring_freq = 10;
+	double ring_phase = 0;
+	uint64_t i;
+	for (i = 0; i < n; i++) {
+		if (uniform() < 1.5 / rate_hz) {
+			ring = amplitude * (0.5 + uniform());
+			ring_freq = 2 + 4 * uniform();
+		}
+		ring_phase += 2 * PI * ring_freq / rate_hz;
+		ring *= exp(-4.0 / rate_hz);
+		vec_t a = { 0.2 * ring * cos(ring_phase), 0.3 * ring * sin(ring_phase * 0.7),
+				ring * sin(ring_phase) };
+		emit(a);
+	}
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: tracegen [-r rate_hz] [-s seed] [-p pitch_deg] [-l roll_deg]"
+			" [-b bias_lsb] [-n noise_lsb] segment...\n"
+			"segments: still:s walk:s[:spm[:mg[:sway_mg]]] run:s[:spm[:mg[:sway_mg]]] bumpy:s[:mg]\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[]) {
+	double pitch = 0;
+	double roll = 0;
+	double bias_lsb = 0;
+	unsigned seed = 1;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:s:p:l:b:n:")) != -1) {
+		switch (opt) {
+		case 'r':
+			rate_hz = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		case 'p':
+			pitch = atof(optarg);
+			break;
+		case 'l':
+			roll = atof(optarg);
+			break;
+		case 'b':
+			bias_lsb = atof(optarg);
+			break;
+		case 'n':
+			noise_lsb = atof(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind >= argc || rate_hz == 0) {
+		usage();
+	}
+	srand(seed);
+	set_orientation(pitch, roll);
+	bias.x = bias_lsb;
+	bias.y = -bias_lsb / 2;
+	bias.z = bias_lsb / 3;
+
+	printf("# rate_hz %u\n", rate_hz);
+	int i;
+	for (i = optind; i < argc; i++) {
+		char kind[16] = "";
+		double seconds = 0, cadence = 0, amplitude = 0, sway = -1;
+		int fields = sscanf(argv[i], "%15[a-z]:%lf:%lf:%lf:%lf", kind, &seconds,
+				&cadence, &amplitude, &sway);
+		if (fields < 2) {
+			usage();
+		}
+		if (strcmp(kind, "still") == 0) {
+			generate_still(seconds);
+		} else if (strcmp(kind, "walk") == 0) {
+			generate_gait(seconds, fields > 2 ? cadence : 110,
+					fields > 3 ? amplitude : 300, sway >= 0 ? sway : 100);
+		} else if (strcmp(kind, "run") == 0) {
+			generate_gait(seconds, fields > 2 ? cadence : 165,
+					fields > 3 ? amplitude : 1200, sway >= 0 ? sway : 250);
+		} else if (strcmp(kind, "bumpy") == 0) {
+			generate_bumpy(seconds, fields > 2 ? cadence : 400);
+		} else {
+			usage();
+		}
+	}
+	printf("# steps %u\n", steps_taken);
+	return 0;
+}
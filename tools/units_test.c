@@ -0,0 +1,225 @@
+/*
+ * File: units_test.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Checks the fixed point conversions in units.c exhaustively against long double
+ * and double references:
+ *   - every int16 raw reading at each accelerometer range, in milli-g,
+ *     milli-m/s^2 and each display unit,
+ *   - every acceleration up to 16g back to raw, between milli-g and
+ *     milli-m/s^2 both ways, and raw readings through milli-g and back,
+ *   - every distance from 0 to 250km, in milli-miles and as the km and miles
+ *     text shown on the display, and every milli-mile up to 250km in meters,
+ *   - every 16 bit part of every 16 bit whole, as a percentage.
+ * Prints the first few mismatches of each check and exits with 1 if any fail.
+ *
+ * Build from the project root with:
+ *   gcc -O2 -std=c99 -I. tools/units_test.c units.c format.c -lm -o units_test
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "units.h"
+#include "format.h"
+
+/* Ranges of the ADXL345 in g. */
+static const uint8_t ranges[] = { 2, 4, 8, 16 };
+
+/* Largest distance checked, in meters. */
+#define MAX_DISTANCE 250000
+
+/* Largest acceleration checked, 16g, in milli-g and milli-m/s^2. */
+#define MAX_MILLI_G 16000
+#define MAX_MILLI_MS2 156907
+
+/* Mismatches printed per check. */
+#define MAX_REPORTED 5
+
+static uint32_t failures;
+
+/* Counts a mismatch, printing the first few of a check. */
+static void report(uint32_t *mismatches, const char *what, long long input, long long got,
+		long long expected) {
+	if (*mismatches < MAX_REPORTED) {
+		printf("  %s(%lld) = %lld, expected %lld\n", what, input, got, expected);
+	}
+	(*mismatches)++;
+}
+
+/* Prints the result of a check and adds its mismatches to the failures. */
+static void finish(const char *check, uint32_t mismatches, uint64_t checked) {
+	printf("%s: %s, %llu checked, %u wrong\n", check, mismatches ? "FAIL" : "ok",
+			(unsigned long long) checked, mismatches);
+	failures += mismatches;
+}
+
+/* Rounds to nearest with halves away from zero, as the conversions do. */
+static long long round_away(long double value) {
+	return value >= 0 ? (long long) floorl(value + 0.5L) : -(long long) floorl(-value + 0.5L);
+}
+
+/* Full resolution keeps 4mg per LSB by adding a bit per doubling of the range,
+ * 10 bits at 2g up to 13 bits at 16g. The references take the scale from the
+ * range that way rather than from ACCL_FULL_RES_LSB_PER_G. The products below
+ * are exact in long double, so a single rounding leaves exact halves exact. */
+static void check_acceleration(void) {
+	uint32_t mismatches = 0;
+	uint64_t checked = 0;
+	uint8_t r;
+	for (r = 0; r < sizeof(ranges); r++) {
+		uint8_t bits = 10;
+		uint8_t range;
+		for (range = 2; range < ranges[r]; range *= 2) {
+			bits++;
+		}
+		long double lsb_per_g = (long double) (1 << bits) / (2 * ranges[r]);
+		int32_t raw;
+		for (raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+			long long milli_g = round_away(raw * 1000.0L / lsb_per_g);
+			long long milli_ms2 = round_away(raw * 980665.0L / (lsb_per_g * 100));
+			if (raw_to_milli_g(raw) != milli_g) {
+				report(&mismatches, "raw_to_milli_g", raw, raw_to_milli_g(raw), milli_g);
+			}
+			if (raw_to_milli_ms2(raw) != milli_ms2) {
+				report(&mismatches, "raw_to_milli_ms2", raw, raw_to_milli_ms2(raw), milli_ms2);
+			}
+			if (convert_accl_units(raw, DISPLAY_RAW) != raw) {
+				report(&mismatches, "convert_accl_units raw", raw,
+						convert_accl_units(raw, DISPLAY_RAW), raw);
+			}
+			if (convert_accl_units(raw, DISPLAY_G) != milli_g) {
+				report(&mismatches, "convert_accl_units g", raw,
+						convert_accl_units(raw, DISPLAY_G), milli_g);
+			}
+			if (convert_accl_units(raw, DISPLAY_MS2) != milli_ms2) {
+				report(&mismatches, "convert_accl_units m/s^2", raw,
+						convert_accl_units(raw, DISPLAY_MS2), milli_ms2);
+			}
+			checked += 5;
+		}
+	}
+	finish("acceleration", mismatches, checked);
+}
+
+/* Checks the conversions back towards raw and between g and m/s^2 in both
+ * directions. 9.80665 is 196133 / 20000, so milli-g to milli-m/s^2 has exact
+ * halves, which round away from zero, and the other way has none. A milli-g is
+ * finer than a raw LSB and a milli-m/s^2 finer than a milli-g, so going to the
+ * finer unit and back must give the reading or value started from. */
+static void check_acceleration_inverse(void) {
+	uint32_t mismatches = 0;
+	uint64_t checked = 0;
+	int32_t value;
+	for (value = -MAX_MILLI_G; value <= MAX_MILLI_G; value++) {
+		long long raw = round_away(value * 256.0L / 1000);
+		long long milli_ms2 = round_away(value * 196133.0L / 20000);
+		if (milli_g_to_raw(value) != raw) {
+			report(&mismatches, "milli_g_to_raw", value, milli_g_to_raw(value), raw);
+		}
+		if (milli_g_to_milli_ms2(value) != milli_ms2) {
+			report(&mismatches, "milli_g_to_milli_ms2", value, milli_g_to_milli_ms2(value),
+					milli_ms2);
+		}
+		if (milli_ms2_to_milli_g(milli_g_to_milli_ms2(value)) != value) {
+			report(&mismatches, "milli_ms2_to_milli_g(milli_g_to_milli_ms2)", value,
+					milli_ms2_to_milli_g(milli_g_to_milli_ms2(value)), value);
+		}
+		checked += 3;
+	}
+	for (value = -MAX_MILLI_MS2; value <= MAX_MILLI_MS2; value++) {
+		long long milli_g = round_away(value * 20000.0L / 196133);
+		if (milli_ms2_to_milli_g(value) != milli_g) {
+			report(&mismatches, "milli_ms2_to_milli_g", value, milli_ms2_to_milli_g(value),
+					milli_g);
+		}
+		checked++;
+	}
+	for (value = INT16_MIN; value <= INT16_MAX; value++) {
+		int32_t milli_g = raw_to_milli_g(value);
+		if (milli_g >= -MAX_MILLI_G && milli_g <= MAX_MILLI_G
+				&& milli_g_to_raw(milli_g) != value) {
+			report(&mismatches, "milli_g_to_raw(raw_to_milli_g)", value, milli_g_to_raw(milli_g),
+					value);
+		}
+		checked++;
+	}
+	finish("acceleration inverse", mismatches, checked);
+}
+
+/* Checks milli-miles against meters / 1609.344 rounded to nearest, and the text
+ * shown for km and miles against printf of the exact values. */
+static void check_distance(void) {
+	uint32_t mismatches = 0;
+	uint64_t checked = 0;
+	uint32_t meters;
+	for (meters = 0; meters <= MAX_DISTANCE; meters++) {
+		long long milli_miles = round_away(meters * 1000000.0L / 1609344);
+		uint32_t got = meters_to_milli_miles(meters);
+		if (got != milli_miles) {
+			report(&mismatches, "meters_to_milli_miles", meters, got, milli_miles);
+		}
+		char text[16];
+		char expected[32];
+		format_fixed(text, got, 3);
+		snprintf(expected, sizeof(expected), "%.3Lf", milli_miles / 1000.0L);
+		if (strcmp(text, expected) != 0) {
+			printf("  miles text for %u m is %s, expected %s\n", meters, text, expected);
+			mismatches++;
+		}
+		format_fixed(text, meters, 3);
+		snprintf(expected, sizeof(expected), "%.3Lf", meters / 1000.0L);
+		if (strcmp(text, expected) != 0) {
+			printf("  km text for %u m is %s, expected %s\n", meters, text, expected);
+			mismatches++;
+		}
+		checked += 3;
+	}
+	uint32_t milli_miles;
+	uint32_t max_milli_miles = meters_to_milli_miles(MAX_DISTANCE);
+	for (milli_miles = 0; milli_miles <= max_milli_miles; milli_miles++) {
+		long long meters = round_away(milli_miles * 1609344.0L / 1000000);
+		uint32_t got = milli_miles_to_meters(milli_miles);
+		if (got != meters) {
+			report(&mismatches, "milli_miles_to_meters", milli_miles, got, meters);
+		}
+		checked++;
+	}
+	finish("distance", mismatches, checked);
+}
+
+/* Checks every part of every whole against floor(part * 100 / whole) in double,
+ * which is exact as part * 100 is below 2^23. */
+static void check_percent(void) {
+	uint32_t mismatches = 0;
+	uint64_t checked = 0;
+	uint32_t whole;
+	for (whole = 0; whole <= UINT16_MAX; whole++) {
+		percent_scale_t scale;
+		init_percent_scale(&scale, whole);
+		uint32_t part;
+		for (part = 0; part <= UINT16_MAX; part++) {
+			uint32_t expected = whole ? (uint32_t) floor(part * 100.0 / whole) : 100;
+			uint32_t got = to_percent(&scale, part);
+			if (got != expected) {
+				report(&mismatches, "to_percent", (long long) whole << 16 | part, got, expected);
+			}
+		}
+		checked += UINT16_MAX + 1;
+	}
+	finish("percent", mismatches, checked);
+}
+
+int main(void) {
+	check_acceleration();
+	check_acceleration_inverse();
+	check_distance();
+	check_percent();
+	return failures ? 1 : 0;
+}
@@ -13,11 +13,11 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include "driverlib/sysctl.h"
-#include "OrbitOLED/OrbitOLEDInterface.h"
 #include "driverlib/adc.h"
 #include "inc/hw_memmap.h"
 
 #include "ui.h"
+#include "units.h"
 #include "display.h"
 #include "potentiometer.h"
 #include "accelerometer.h"
@@ -33,80 +33,174 @@ static ui_state state;
 static distance_units dist_state;
 static step_units step_state;
 
+/* Unit to display acceleration in. */
+static display_unit accl_state;
+
 /* Steps counted which can be set in test mode. */
 static uint16_t steps_counted;
 
 /* Distance recorded in meters.
  * Although values will be output as kilometers and miles, we want to avoid floats.
- * This value can be adjusted in test mode. */
+ * Derived from steps_counted whenever it changes. */
 static uint16_t distance_traveled;
 
+/* Distance recorded in thousandths of a mile, derived along with distance_traveled. */
+static uint32_t distance_milli_miles;
+
 /* User set step goal. */
 static uint16_t step_goal;
 
+/* Reciprocal of the step goal, updated with the goal, used to show steps as a goal percentage. */
+static percent_scale_t goal_scale;
+
+/* Steps counted as a percentage of the step goal, derived when either changes. */
+static uint32_t goal_percent;
+
+/* Steps per minute measured by the accelerometer, 0 when not walking. */
+static uint16_t cadence;
+
+/* Latest raw accelerometer reading, kept while the accelerometer is idle. */
+static vector3_t acceleration;
+
 /* A flag to keep track of whether the current goal has been reach yet.
  * This is to ensure that the user is only notified once when they reach their goal. */
 static bool goal_reached_flag;
 
-/* A value to keep track of how long the magnitude has been above the threshold.
- * A step will be registered if the magnitude is above the threshold for this duration. */
-static uint16_t above_threshold_duration;
+/* Bits of the UI model that can change what is shown on the display. */
+#define DIRTY_STEPS     0x01
+#define DIRTY_DISTANCE  0x02
+#define DIRTY_GOAL      0x04
+#define DIRTY_UNITS     0x08
+#define DIRTY_STATE     0x10
+#define DIRTY_TEST_MODE 0x20
+#define DIRTY_NEW_GOAL  0x40
+#define DIRTY_CADENCE   0x80
+#define DIRTY_ACCL      0x100
+
+/* Parts of the model that have changed since the display was last rendered.
+ * The display is only redrawn when a bit the current screen depends on is set. */
+static uint16_t dirty_mask;
+
+/* Last potentiometer goal shown in the set goal state, used to detect changes. */
+static uint16_t pot_goal;
+
+/* Number of UI tasks (40Hz) the goal reached screen stays up for, ~3 seconds. */
+#define GOAL_NOTIFY_TICKS 120
+
+/* Remaining UI tasks until the goal reached screen is replaced by the regular display.
+ * The display is not redrawn while this is non zero. */
+static uint8_t goal_notify_ticks;
+
+/* Flags part of the model as changed so the display picks it up on the next render. */
+static void mark_dirty(uint16_t mask) {
+	dirty_mask |= mask;
+}
+
+static uint16_t convert_to_dist(uint16_t steps) {
+	uint16_t distance = (steps * 9) / 10;
+	return distance;
+}
+
+/* Checks if step goal has been reached.
+ * Notify user if it has. This is called whenever the steps or the goal change
+ * instead of being polled. */
+static void check_step_goal(void) {
+	if (goal_reached_flag == false && steps_counted >= step_goal) {
+		/* Notify user has reached goal */
+		display_goal_reached(steps_counted, distance_traveled, step_goal);
+		goal_reached_flag = true;
+		goal_notify_ticks = GOAL_NOTIFY_TICKS;
+	}
+}
+
+/* Sets the steps counted and updates the values derived from it once. */
+static void set_steps(uint16_t steps) {
+	steps_counted = steps;
+	distance_traveled = convert_to_dist(steps);
+	distance_milli_miles = meters_to_milli_miles(distance_traveled);
+	goal_percent = to_percent(&goal_scale, steps);
+	mark_dirty(DIRTY_STEPS | DIRTY_DISTANCE);
+	check_step_goal();
+}
+
+/* Sets the step goal and updates the values derived from it once. */
+static void set_goal(uint16_t goal) {
+	step_goal = goal;
+	init_percent_scale(&goal_scale, goal);
+	goal_percent = to_percent(&goal_scale, steps_counted);
+	goal_reached_flag = false;
+	mark_dirty(DIRTY_GOAL);
+	check_step_goal();
+}
 
 /* Initializes UI data */
 void init_ui(void) {
 	initDisplay();
 	test_mode = false;
-	OLEDStringDraw("Steps Counted", 0, 0);
+	display_string("Steps Counted", 0, 0);
 	state = STEPS_COUNTED;
 	dist_state = KMS;
 	step_state = STEPS;
-	step_goal = 1000;
-	goal_reached_flag = false;
+	accl_state = DISPLAY_G;
+	set_goal(1000);
+	mark_dirty(DIRTY_STATE);
 }
 
 /* Load the state which is called during initialization or state change. */
 static void load_state(ui_state state) {
+	goal_notify_ticks = 0;
 	switch (state) {
 	case STEPS_COUNTED:
 		state = STEPS_COUNTED;
-		OLEDStringDraw("Steps Counted", 0, 0);
+		display_string("Steps Counted", 0, 0);
 		break;
 	case DISTANCE_TRAVELED:
 		state = DISTANCE_TRAVELED;
-		OLEDStringDraw("Dist. Traveled", 0, 0);
+		display_string("Dist. Traveled", 0, 0);
 		break;
 	case SET_GOAL:
 		state = SET_GOAL;
-		OLEDStringDraw("Set Step Goal", 0, 0);
+		display_string("Set Step Goal", 0, 0);
 		display_val("Current", step_goal, 3);
 		break;
+	case CADENCE:
+		state = CADENCE;
+		display_string("Cadence", 0, 0);
+		break;
+	case ACCELERATION:
+		state = ACCELERATION;
+		display_string("Acceleration", 0, 0);
+		break;
 	}
+	mark_dirty(DIRTY_STATE);
 }
 
 /* Load test mode display and toggles the flag to allow for test mode functionality. */
 void toggle_test_mode(void) {
+	goal_notify_ticks = 0;
 	if (!test_mode) {
 		test_mode = true;
 		clear_display();
-		OLEDStringDraw("TEST MODE", 0, 0);
+		display_string("TEST MODE", 0, 0);
 	} else {
 		test_mode = false;
 		clear_display();
 		load_state(state);
 	}
+	mark_dirty(DIRTY_TEST_MODE);
 }
 
 /* Cycle next UI state */
 void next_ui_state(void) {
 	clear_display();
-	state = (ui_state) ((state + 1) % 3);
+	state = (ui_state) ((state + 1) % UI_STATE_COUNT);
 	load_state(state);
 }
 
 /* Cycle previous UI state */
 void prev_ui_state(void) {
 	clear_display();
-	state = (ui_state) (state - 1 >= 0 ? state - 1 : 2);
+	state = (ui_state) (state == 0 ? UI_STATE_COUNT - 1 : state - 1);
 	load_state(state);
 }
 
@@ -114,14 +208,9 @@ void prev_ui_state(void) {
  * This is used for testing while test mode is enabled. */
 void test_increment(void) {
 	if (steps_counted + 100 > 10000) {
-		steps_counted = 10000;
-	} else {
-		steps_counted += 100;
-	}
-	if (distance_traveled + 90 > 9000) {
-		distance_traveled = 9000;
+		set_steps(10000);
 	} else {
-		distance_traveled += 90;
+		set_steps(steps_counted + 100);
 	}
 }
 
@@ -129,14 +218,9 @@ void test_increment(void) {
  * This is used for testing while test mode is enabled. */
 void test_decrement(void) {
 	if (steps_counted - 500 < 0) {
-		steps_counted = 0;
+		set_steps(0);
 	} else {
-		steps_counted -= 500;
-	}
-	if (distance_traveled - 450 < 0) {
-		distance_traveled = 0;
-	} else {
-		distance_traveled -= 450;
+		set_steps(steps_counted - 500);
 	}
 	/* This lets us repeatedly test the functionality that notifies the user when goal reached. */
 	if (steps_counted < step_goal) {
@@ -144,8 +228,8 @@ void test_decrement(void) {
 	}
 }
 
-/* Changes the unit to display steps/distance.
- * Step and distance have separate states for which unit to output. */
+/* Changes the unit to display steps/distance/acceleration.
+ * Each has a separate state for which unit to output. */
 void change_step_units(void) {
 	//toggle units depending on current state - probably meant to be a switch
 	if (get_ui_state() == DISTANCE_TRAVELED) {
@@ -168,24 +252,27 @@ void change_step_units(void) {
 			step_state = STEPS;
 			break;
 		}
+	} else if (get_ui_state() == ACCELERATION) {
+		//cycle through raw, g and m/s^2
+		accl_state = (display_unit) ((accl_state + 1) % DISPLAY_UNIT_COUNT);
 	}
+	mark_dirty(DIRTY_UNITS);
 }
 
 /* Update the goal set by the user from the potentiometer. */
 void set_goal_potentiometer(void) {
 	uint16_t new_goal = get_potentiometer_data();
-	step_goal = new_goal;
 	state = STEPS_COUNTED;
-	OLEDStringDraw("                ", 0, 4);
-	OLEDStringDraw("Steps Counted", 0, 0);
-	goal_reached_flag = false;
+	display_string("                ", 0, 3);
+	display_string("Steps Counted", 0, 0);
+	mark_dirty(DIRTY_STATE);
+	set_goal(new_goal);
 }
 
 /* Sets the step distance to 0. */
 void reset_distance(void) {
-	distance_traveled = 0;
-	steps_counted = 0;
 	goal_reached_flag = false;
+	set_steps(0);
 }
 
 /*Handle the display of test mode*/
@@ -202,7 +289,6 @@ void handle_normal_mode_display(void) {
 			//add the units on the end of steps_counted
 			display_steps(steps_counted, 2, "steps");
 		} else {
-			uint16_t goal_percent = (steps_counted * 100 / step_goal); /* Gets around floats */
 			display_val("Goal %", goal_percent, 2);
 		}
 		break;
@@ -211,17 +297,52 @@ void handle_normal_mode_display(void) {
 			//add the units on the end of steps_counted
 			display_val_units("", distance_traveled, 2, "km");
 		} else {
-			display_val_units("", distance_traveled / 1.609, 2, "miles");
+			display_val_units("", distance_milli_miles, 2, "miles");
 		}
 		break;
 	case SET_GOAL:
-		display_val("New Goal", get_potentiometer_data(), 2);
+		display_val("New Goal", pot_goal, 2);
+		break;
+	case CADENCE:
+		display_steps(cadence, 2, "steps/min");
 		break;
+	case ACCELERATION:
+		display_accl("X", acceleration.x, accl_state, 1);
+		display_accl("Y", acceleration.y, accl_state, 2);
+		display_accl("Z", acceleration.z, accl_state, 3);
+		break;
+	}
+}
+
+/* Returns the parts of the model that the screen currently shown depends on. */
+static uint16_t screen_dependencies(void) {
+	if (test_mode) {
+		return DIRTY_STEPS | DIRTY_DISTANCE | DIRTY_TEST_MODE;
+	}
+	switch (state) {
+	case STEPS_COUNTED:
+		return DIRTY_STEPS | DIRTY_GOAL | DIRTY_UNITS | DIRTY_STATE | DIRTY_TEST_MODE;
+	case DISTANCE_TRAVELED:
+		return DIRTY_DISTANCE | DIRTY_UNITS | DIRTY_STATE | DIRTY_TEST_MODE;
+	case SET_GOAL:
+		return DIRTY_NEW_GOAL | DIRTY_GOAL | DIRTY_STATE | DIRTY_TEST_MODE;
+	case CADENCE:
+		return DIRTY_CADENCE | DIRTY_STATE | DIRTY_TEST_MODE;
+	case ACCELERATION:
+		return DIRTY_ACCL | DIRTY_UNITS | DIRTY_STATE | DIRTY_TEST_MODE;
 	}
+	return 0xFFFF;
 }
 
-/* Update display to show relevant UI content. */
+/* Update display to show relevant UI content.
+ * Nothing is drawn unless something the current screen shows has changed. */
 void display_ui(void) {
+	if (goal_notify_ticks > 0 || (dirty_mask & screen_dependencies()) == 0) {
+		return;
+	}
+	/* Every screen change marks DIRTY_STATE or DIRTY_TEST_MODE, so
+	 * changes hidden from this screen do not need to be remembered. */
+	dirty_mask = 0;
 	if (test_mode) {
 		handle_test_mode_display();
 	} else {
@@ -239,61 +360,71 @@ bool is_test_mode(void) {
 	return test_mode;
 }
 
-static uint16_t convert_to_dist(uint16_t steps) {
-	uint16_t distance = (steps * 9) / 10;
-	return distance;
+/* Returns the number of steps counted */
+uint16_t get_steps_counted(void) {
+	return steps_counted;
+}
+
+/* Replaces the goal reached screen with the regular display. */
+static void end_goal_notification(void) {
+	clear_display();
+	if (is_test_mode()) {
+		display_string("TEST MODE", 0, 0);
+	} else {
+		load_state(state);
+	}
+	mark_dirty(DIRTY_STATE | DIRTY_TEST_MODE);
 }
 
-/* Runs the UI task corresponding to the state. */
+/* Runs the UI task corresponding to the state.
+ * Also takes down the goal reached screen once it has been shown long enough. */
 void ui_task(void) {
+	if (goal_notify_ticks > 0) {
+		goal_notify_ticks--;
+		if (goal_notify_ticks == 0) {
+			end_goal_notification();
+		}
+	}
 	switch (get_ui_state()) {
 	case STEPS_COUNTED:
-		break;
 	case DISTANCE_TRAVELED:
-		distance_traveled = convert_to_dist(steps_counted);
+	case CADENCE:
+	case ACCELERATION:
 		break;
-	case SET_GOAL:
+	case SET_GOAL: {
 		ADCProcessorTrigger(ADC0_BASE, 3);
+		uint16_t goal = get_potentiometer_data();
+		if (goal != pot_goal) {
+			pot_goal = goal;
+			mark_dirty(DIRTY_NEW_GOAL);
+		}
 		break;
 	}
-}
-
-/* Checks if step goal has been reached.
- * Notify user if it has. */
-void check_step_goal(void) {
-	if (goal_reached_flag == false && steps_counted >= step_goal) {
-		/* Notify user has reached goal */
-		display_goal_reached(steps_counted, distance_traveled, step_goal);
-		SysCtlDelay(SysCtlClockGet());
-		goal_reached_flag = true;
-		/* Return to regular display */
-		clear_display();
-		if (is_test_mode()) {
-			OLEDStringDraw("TEST MODE", 0, 0);
-		} else {
-			load_state(state);
-		}
 	}
 }
 
-/* A function to determine whether a step should be counted.
- * The function takes a parameter min_step_duration that dictates how long a step should
- * be relative to the number of times this function is called.
+/* A function to read a new accelerometer sample, count any steps confirmed and
+ * pick up changes in cadence and acceleration. Must be called once per accelerometer sample, at get_accl_sample_rate().
  * To quantify a step...
- * The magnitude must cross the threshold.
- * The magnitude must be above threshold for at least min_step_duration times.
- * The magnitude must return below the threshold.
- * If all these conditions are met then a step is registered. */
-void handle_step_event(uint8_t min_step_duration) {
+ * The filtered magnitude must peak above the adaptive threshold.
+ * The peak must come after the refractory period of the last step, which is a
+ * fraction of the recent step interval so bounces within a step are not counted.
+ * The magnitude around the peak must repeat at a walking or running cadence. */
+void handle_step_event(void) {
 	vector3_t acceleration_data = get_accl_data();
-	bool step_detected = detect_step(acceleration_data);
-	if (step_detected) {
-		above_threshold_duration++;
-	} else {
-		if (above_threshold_duration >= min_step_duration) {
-			steps_counted++;
-		}
-		above_threshold_duration = 0;
+	if (acceleration_data.x != acceleration.x || acceleration_data.y != acceleration.y
+			|| acceleration_data.z != acceleration.z) {
+		acceleration = acceleration_data;
+		mark_dirty(DIRTY_ACCL);
+	}
+	uint16_t steps = detect_step(acceleration_data);
+	if (steps > 0) {
+		set_steps(steps_counted + steps);
+	}
+	uint16_t new_cadence = get_cadence();
+	if (new_cadence != cadence) {
+		cadence = new_cadence;
+		mark_dirty(DIRTY_CADENCE);
 	}
 }
 
@@ -13,9 +13,12 @@
 #define UI_H
 
 typedef enum {
-	STEPS_COUNTED, SET_GOAL, DISTANCE_TRAVELED
+	STEPS_COUNTED, SET_GOAL, DISTANCE_TRAVELED, CADENCE, ACCELERATION
 } ui_state;
 
+/* Number of UI states cycled through by next_ui_state and prev_ui_state. */
+#define UI_STATE_COUNT 5
+
 typedef enum {
 	KMS, MILES
 } distance_units;
@@ -27,8 +30,8 @@ typedef enum {
 /* Initializes UI data */
 void init_ui(void);
 
-/* Changes the unit to display steps/distance.
- * Step and distance have separate states for which unit to output. */
+/* Changes the unit to display steps/distance/acceleration.
+ * Each has a separate state for which unit to output. */
 void change_step_units(void);
 
 /* Load test mode display and toggles the flag to allow for test mode functionality. */
@@ -60,7 +63,8 @@ void handle_test_mode_display(void);
 /*Handle the display of normal mode (not test mode)*/
 void handle_normal_mode_display(void);
 
-/* Update display to show relevant UI content. */
+/* Update display to show relevant UI content.
+ * Only redraws when data the current screen depends on has changed. */
 void display_ui(void);
 
 /* Returns the current UI state */
@@ -69,16 +73,15 @@ ui_state get_ui_state(void);
 /* Returns true if test mode is on */
 bool is_test_mode(void);
 
-/* Runs the UI task corresponding to the state. */
-void ui_task(void);
+/* Returns the number of steps counted */
+uint16_t get_steps_counted(void);
 
-/* Checks if step goal has been reached.
- * Notify user if it has. */
-void check_step_goal(void);
+/* Runs the UI task corresponding to the state.
+ * Also takes down the goal reached screen once it has been shown long enough. */
+void ui_task(void);
 
-/* A function to determine whether a step should be counted.
- * The function takes a parameter min_step_duration that dictates how long a step should
- * be relative to the number of times this function is called. */
-void handle_step_event(uint8_t min_step_duration);
+/* A function to read a new accelerometer sample, count any steps confirmed and
+ * pick up changes in cadence and acceleration. Must be called once per accelerometer sample. */
+void handle_step_event(void);
 
 #endif /* UI_H */
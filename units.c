@@ -0,0 +1,133 @@
+/*
+ * File: units.c
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Fixed point unit conversions for distance, acceleration and percentages.
+ * Every conversion is an integer multiply by a precomputed reciprocal followed
+ * by a shift, so no floating point or divides are needed when displaying values.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "units.h"
+
+/* The constants are Q32 so that rounding matches a double precision
+ * calculation over the full range of the inputs. */
+#define Q32_HALF 0x80000000ULL
+/* 1 / 1.609344, miles per kilometer, in Q32. */
+#define MILES_PER_KM_Q32 2668768950ULL
+/* 1.609344, kilometers per mile, in Q32. */
+#define KM_PER_MILE_Q32 6912079848ULL
+/* Standard gravity 9.80665 in Q32. */
+#define MS2_PER_G_Q32 42119241034LL
+/* 9806.65 / 256, thousandths of a m/s^2 per full resolution LSB, in Q32. */
+#define MILLI_MS2_PER_LSB_Q32 164528285287LL
+
+/* Multiplies a signed value by a Q32 constant, rounding half away from zero. */
+static int32_t mul_q32_signed(int32_t value, int64_t constant_q32) {
+	if (value >= 0) {
+		return (int32_t) (((uint64_t) value * constant_q32 + Q32_HALF) >> 32);
+	}
+	return -(int32_t) (((uint64_t) -value * constant_q32 + Q32_HALF) >> 32);
+}
+
+/* Converts meters to thousandths of a mile, rounded to nearest. */
+uint32_t meters_to_milli_miles(uint32_t meters) {
+	return (uint32_t) (((uint64_t) meters * MILES_PER_KM_Q32 + Q32_HALF) >> 32);
+}
+
+/* Converts thousandths of a mile to meters, rounded to nearest. */
+uint32_t milli_miles_to_meters(uint32_t milli_miles) {
+	return (uint32_t) (((uint64_t) milli_miles * KM_PER_MILE_Q32 + Q32_HALF) >> 32);
+}
+
+/* Converts a raw full resolution accelerometer reading to thousandths of a g.
+ * 1000 / 256 is exactly 125 / 32, so this is a multiply and a rounded shift. */
+int32_t raw_to_milli_g(int16_t raw) {
+	int32_t scaled = (int32_t) raw * 125;
+	if (scaled >= 0) {
+		return (scaled + 16) >> 5;
+	}
+	return -((-scaled + 16) >> 5);
+}
+
+/* Converts a raw full resolution accelerometer reading to thousandths of a m/s^2. */
+int32_t raw_to_milli_ms2(int16_t raw) {
+	return mul_q32_signed(raw, MILLI_MS2_PER_LSB_Q32);
+}
+
+/* Converts thousandths of a g to a raw full resolution accelerometer reading.
+ * 256 / 1000 is exactly 32 / 125, the divide by a constant compiles to a multiply. */
+int16_t milli_g_to_raw(int32_t milli_g) {
+	int32_t scaled = milli_g * 32;
+	if (scaled >= 0) {
+		return (scaled + 62) / 125;
+	}
+	return -((-scaled + 62) / 125);
+}
+
+/* Converts thousandths of a g to thousandths of a m/s^2. */
+int32_t milli_g_to_milli_ms2(int32_t milli_g) {
+	return mul_q32_signed(milli_g, MS2_PER_G_Q32);
+}
+
+/* Converts thousandths of a m/s^2 to thousandths of a g.
+ * 1 / 9.80665 is exactly 20000 / 196133, which has no halves to round. A Q32
+ * reciprocal is not precise enough for the results just either side of one, so
+ * this divides by the constant, which compiles to a multiply. The magnitude
+ * times 20000 fits in 32 bits up to 214000m/s^2. */
+int32_t milli_ms2_to_milli_g(int32_t milli_ms2) {
+	if (milli_ms2 >= 0) {
+		return ((uint32_t) milli_ms2 * 20000u + 196133u / 2) / 196133u;
+	}
+	return -(int32_t) (((uint32_t) -milli_ms2 * 20000u + 196133u / 2) / 196133u);
+}
+
+/* Converts a raw full resolution reading to the given display unit. */
+int32_t convert_accl_units(int16_t raw, display_unit unit) {
+	switch (unit) {
+	case DISPLAY_G:
+		return raw_to_milli_g(raw);
+	case DISPLAY_MS2:
+		return raw_to_milli_ms2(raw);
+	case DISPLAY_RAW:
+	default:
+		return raw;
+	}
+}
+
+/* Bits in part * 100 for a 16 bit part. */
+#define PERCENT_PRODUCT_BITS 23
+
+/* Prepares the reciprocal of whole for percentage calculations.
+ * With the whole below 2^bits, a shift of 23 + bits and the reciprocal rounded up
+ * leave an error below whole in multiplier * whole - 2^shift. Over any product
+ * below 2^23 that adds less than 1 / whole, so (part * 100 * multiplier) >> shift
+ * equals floor(part * 100 / whole) for every 16 bit part and whole, and the
+ * multiplier stays below 2^24 + 1. */
+void init_percent_scale(percent_scale_t *scale, uint16_t whole) {
+	if (whole == 0) {
+		scale->multiplier = 0;
+		scale->shift = 0;
+		return;
+	}
+	uint8_t bits = 0;
+	while ((1u << bits) < whole) {
+		bits++;
+	}
+	scale->shift = PERCENT_PRODUCT_BITS + bits;
+	scale->multiplier = (uint32_t) (((1ULL << scale->shift) + whole - 1) / whole);
+}
+
+/* Returns part as a percentage of the whole, rounded down.
+ * Both factors are 32 bits, a single UMULL on the Cortex-M4. */
+uint32_t to_percent(const percent_scale_t *scale, uint16_t part) {
+	if (scale->multiplier == 0) {
+		return 100;
+	}
+	return (uint32_t) (((uint64_t) (part * 100u) * scale->multiplier) >> scale->shift);
+}
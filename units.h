@@ -0,0 +1,70 @@
+/*
+ * File: units.h
+ *
+ * Authors: Kenneth Huang, Sarah Kellock
+ *
+ * Date: May 2022
+ *
+ * Fixed point unit conversions for distance, acceleration and percentages.
+ * Every conversion is an integer multiply by a precomputed reciprocal followed
+ * by a shift, so no floating point or divides are needed when displaying values.
+ */
+
+#ifndef UNITS_H
+#define UNITS_H
+
+/* ADXL345 full resolution mode keeps 3.9mg per LSB (256 LSB per g) at every range. */
+#define ACCL_FULL_RES_LSB_PER_G 256
+
+/* Units acceleration can be shown in. */
+typedef enum {
+	DISPLAY_RAW, DISPLAY_G, DISPLAY_MS2
+} display_unit;
+
+/* Number of display units cycled through. */
+#define DISPLAY_UNIT_COUNT 3
+
+/* Reciprocal of a whole used to turn parts of it into a percentage.
+ * Set up once with init_percent_scale whenever the whole changes. */
+typedef struct {
+	uint32_t multiplier; /* ceil(2^shift / whole), or 0 when the whole is 0. */
+	uint8_t shift;       /* 23 more than the bits in the whole, so the multiplier fits in 32 bits. */
+} percent_scale_t;
+
+/* Converts meters to thousandths of a mile, rounded to nearest.
+ * Matches the exact result for every distance up to 250km. */
+uint32_t meters_to_milli_miles(uint32_t meters);
+
+/* Converts thousandths of a mile to meters, rounded to nearest.
+ * Matches the exact result for every distance up to 250km. */
+uint32_t milli_miles_to_meters(uint32_t milli_miles);
+
+/* Converts a raw full resolution accelerometer reading to thousandths of a g, rounded to nearest. */
+int32_t raw_to_milli_g(int16_t raw);
+
+/* Converts a raw full resolution accelerometer reading to thousandths of a m/s^2, rounded to nearest. */
+int32_t raw_to_milli_ms2(int16_t raw);
+
+/* Converts thousandths of a g to a raw full resolution accelerometer reading, rounded to nearest.
+ * Valid up to the +-16g the accelerometer measures. */
+int16_t milli_g_to_raw(int32_t milli_g);
+
+/* Converts thousandths of a g to thousandths of a m/s^2, rounded to nearest. */
+int32_t milli_g_to_milli_ms2(int32_t milli_g);
+
+/* Converts thousandths of a m/s^2 to thousandths of a g, rounded to nearest.
+ * Valid up to +-214000m/s^2, far beyond the accelerometer's range. */
+int32_t milli_ms2_to_milli_g(int32_t milli_ms2);
+
+/* Converts a raw full resolution reading to the given display unit.
+ * DISPLAY_RAW is returned unchanged, DISPLAY_G and DISPLAY_MS2 are in thousandths. */
+int32_t convert_accl_units(int16_t raw, display_unit unit);
+
+/* Prepares the reciprocal of whole for percentage calculations. */
+void init_percent_scale(percent_scale_t *scale, uint16_t whole);
+
+/* Returns part as a percentage of the whole, rounded down exactly like part * 100 / whole.
+ * A whole of zero is treated as already complete and gives 100. */
+uint32_t to_percent(const percent_scale_t *scale, uint16_t part);
+
+#endif /* UNITS_H */